@@ -17,10 +17,17 @@
 
 #pragma once
 
+#include <memory>
+
+using std::shared_ptr;
+
 #include <vector>
 
 using std::vector;
 
+#include "calibrated_channel_table.hpp"
+#include "calibration_batch.hpp"
+#include "calibration_kernel.hpp"
 #include "coincidence_matrix.hpp"
 #include "counter_detector.hpp"
 #include "detector.hpp"
@@ -50,10 +57,32 @@ struct Analysis {
     vector<size_t> module_index;
     vector<size_t> group_index;
 
+    // Calibrated quantities of all energy-sensitive detector channels.
+    // The channels of energy_sensitive_detectors[n_detector] occupy the
+    // global indices starting at first_channel_index[n_detector].
+    // For each global index, channel_modules and channel_leaves store the
+    // digitizer module and leaf that the raw data are taken from, and
+    // calibration_kernels the calibration of the channel.
+    shared_ptr<CalibratedChannelTable> calibrated_channels;
+    vector<size_t> first_channel_index;
+    // Index of the energy-sensitive detector of each global channel index.
+    vector<size_t> channel_detector_index;
+    vector<shared_ptr<DigitizerModule>> channel_modules;
+    vector<size_t> channel_leaves;
+    vector<CalibrationKernel> calibration_kernels;
+    // Indices of the energy-sensitive detectors with at least one valid
+    // channel in the current event, in ascending order. Together with the hit
+    // list of the calibrated channel table, it is updated by calibrate(),
+    // load_from_batch() and update_valid_channels().
+    vector<size_t> hit_detectors;
+
     void calibrate(const long long n_entry);
+    Analysis clone() const;
     bool find_module_by_id(size_t &module_index, const u_int32_t id) const;
-    double get_amplitude(const size_t n_detector, const size_t n_channel) const;
+    double get_amplitude(const size_t n_detector, const size_t n_channel,
+                         const long long n_entry) const;
     long long get_counts(const size_t n_detector, const size_t n_channel) const;
+    size_t get_n_counter_detector_channels() const;
     size_t get_n_energy_sensitive_detector_channels() const;
     double get_time(const size_t n_detector, const size_t n_channel) const;
     double get_reference_time(const size_t n_detector,
@@ -73,10 +102,39 @@ struct Analysis {
     void calibrate(const int n_entry);
     void calibrate_counter_detector(const int n_entry, const size_t n_detector,
                                     const size_t n_channel);
+    void calibrate_counter_detector(const int n_entry, const size_t n_detector,
+                                    const size_t n_channel,
+                                    const long long counts);
     void calibrate_energy_sensitive_detector(const int n_entry,
                                              const size_t n_detector,
                                              const size_t n_channel);
+    // Batch calibration:
+    // add_to_batch() copies the raw data of the current entry into a batch.
+    // calibrate_batch() calibrates all events of a batch column by column,
+    // which allows the compiler to vectorize the polynomial calibrations and
+    // gates.
+    // load_from_batch() sets the calibrated leaves (including addback and
+    // count rates) to the values of a single event of a calibrated batch.
+    // The events of a batch have to be loaded in order.
+    // The results are identical to calling calibrate() for each event and
+    // resetting the calibrated leaves in between.
+    // load_raw_from_batch() restores the raw data of the energy-sensitive
+    // detector channels and the digitizer modules of a single event of a
+    // batch that has not been calibrated. Leaves of the digitizer modules
+    // that do not belong to a detector channel are not touched.
+    void add_to_batch(CalibrationBatch &batch, const long long n_entry);
+    void calibrate_batch(CalibrationBatch &batch);
+    void load_from_batch(const CalibrationBatch &batch, const size_t n_event);
+    void load_raw_from_batch(const CalibrationBatch &batch,
+                             const size_t n_event);
+
     void reset_calibrated_leaves();
+    // Recomputes the valid bits of the calibrated channel table from the
+    // calibrated energies and the time-vs-reference-time gates.
+    // calibrate() keeps the bits up to date by itself, so this is only
+    // needed after the calibrated quantities were read from a tree.
+    void update_valid_channels();
+    void update_hits();
     void reset_raw_energy_sensitive_detector_leaves(
         const vector<bool> amp_t_tref_ts = {false, false, false, false});
     void set_up_calibrated_energy_sensitive_detector_branches_for_reading(
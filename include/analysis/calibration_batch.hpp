@@ -0,0 +1,66 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include <vector>
+
+using std::vector;
+
+struct Analysis;
+
+// Column buffers for the calibration of several events at once (see
+// Analysis::calibrate_batch()).
+// The data of a channel in all events of the batch are stored contiguously,
+// i.e. the value of global channel (or module) n_channel in event n_event is
+// at index(n_channel, n_event).
+struct CalibrationBatch {
+    CalibrationBatch(const Analysis &analysis, const size_t capacity);
+
+    const size_t capacity;
+    size_t n_events;
+    vector<long long> entries;
+
+    // Raw data of the energy-sensitive detector channels.
+    // Calibration adds the pseudorandom numbers to the amplitudes in place.
+    vector<double> amplitude;
+    vector<double> time;
+    // Raw data of the digitizer modules, indexed like
+    // Analysis::digitizer_modules.
+    vector<double> reference_time;
+    vector<double> timestamp;
+    // Raw data of the counter detector channels.
+    vector<long long> counts;
+
+    // Calibrated data of the energy-sensitive detector channels.
+    vector<double> energy_calibrated;
+    vector<double> time_calibrated;
+    vector<double> time_vs_reference_time_calibrated;
+    vector<double> timestamp_calibrated;
+    // 1 if the event passed the time-vs-reference-time gate, 0 otherwise.
+    // Stored as a floating-point number, so that the loops that mix it with
+    // the calibrated values can be vectorized even without AVX.
+    vector<double> gate_passed;
+
+    size_t index(const size_t n_channel, const size_t n_event) const {
+        return n_channel * capacity + n_event;
+    }
+    bool is_full() const { return n_events == capacity; }
+    void clear() { n_events = 0; }
+};
@@ -0,0 +1,63 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+
+using std::unique_ptr;
+
+#include <utility>
+
+using std::pair;
+
+#include <vector>
+
+using std::vector;
+
+#include "analysis.hpp"
+#include "tiled_histogram_2d.hpp"
+
+// Set of the coincidence matrices of an analysis, as created by
+// 'histograms_2d'.
+// Sets of the same analysis can be filled in parallel and merged afterwards.
+struct CoincidenceMatrixSet {
+    CoincidenceMatrixSet(const Analysis &analysis);
+    CoincidenceMatrixSet(const CoincidenceMatrixSet &) = delete;
+    CoincidenceMatrixSet &operator=(const CoincidenceMatrixSet &) = delete;
+
+    vector<unique_ptr<TiledHistogram2D>> histograms;
+
+    void add(const CoincidenceMatrixSet &matrix_set);
+    // The energies of the detectors in the hit list of the analysis are read
+    // once per entry, and only pairs of those detectors are tested against the
+    // coincidence pairs of the matrices. Since typical events have only a few
+    // hits, this is much faster than a loop over all coincidence pairs.
+    void fill(const Analysis &analysis);
+    // Write all matrices to the current directory (see
+    // TiledHistogram2D::write()). The memory usage of the tiles is printed,
+    // and for dense matrices also the size of the temporary TH2I.
+    void write(const bool sparse) const;
+
+  private:
+    // Number of times that each ordered pair of energy-sensitive detectors
+    // occurs in the coincidence pairs of a matrix, indexed as
+    // [n_matrix][n_detector_x * n_detectors + n_detector_y].
+    vector<vector<unsigned int>> pair_multiplicities;
+    // Detector index and energy of the hits in the current entry.
+    vector<pair<size_t, double>> hits;
+};
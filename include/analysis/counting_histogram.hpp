@@ -0,0 +1,220 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+
+using std::atomic;
+using std::memory_order_relaxed;
+
+#include <cstdint>
+
+#include <memory>
+
+using std::unique_ptr;
+
+#include <string>
+
+using std::string;
+
+#include "histogram_properties.hpp"
+
+// Uniform binning of an axis with the same bin numbering as ROOT: bin 0 is the
+// underflow bin, bins 1 to n_bins are the regular bins, and bin n_bins + 1 is
+// the overflow bin (which also receives NaN).
+// The bin is found with the same floating-point operations as in
+// TAxis::FindFixBin(), so values on or close to a bin edge end up in the same
+// bin as with TH1::Fill(). A multiplication with the inverse bin width would be
+// faster, but it may select the neighboring bin if the inverse bin width is
+// not exactly representable.
+struct UniformAxis {
+    UniformAxis(const Histogram &properties)
+        : n_bins(properties.n_bins),
+          lower_edge_of_first_bin(properties.lower_edge_of_first_bin),
+          upper_edge_of_last_bin(properties.upper_edge_of_last_bin),
+          range(upper_edge_of_last_bin - lower_edge_of_first_bin) {}
+
+    size_t find_bin(const double x) const {
+        if (x < lower_edge_of_first_bin) {
+            return 0;
+        }
+        if (!(x < upper_edge_of_last_bin)) {
+            return n_bins + 1;
+        }
+        // Like in ROOT, rounding may put a value just below the upper edge
+        // into the overflow bin.
+        return 1 + (size_t)(n_bins * (x - lower_edge_of_first_bin) / range);
+    }
+
+    const unsigned int n_bins;
+    const double lower_edge_of_first_bin, upper_edge_of_last_bin;
+    const double range;
+};
+
+template <typename Count> inline void increment(Count &count) { ++count; }
+
+template <typename Count> inline void increment(atomic<Count> &count) {
+    count.fetch_add(1, memory_order_relaxed);
+}
+
+template <typename Count> inline uint64_t load(const Count &count) {
+    return count;
+}
+
+template <typename Count> inline uint64_t load(const atomic<Count> &count) {
+    return count.load(memory_order_relaxed);
+}
+
+// Histograms that only count entries.
+//
+// Compared to TH1::Fill(), a fill is only a bin lookup and an increment: there
+// are no weights and no running sums for the statistics.
+// The type of the counters is a template parameter. With an atomic type (e.g.
+// atomic<uint64_t>), several threads can fill the same histogram without
+// locks, using relaxed increments.
+// The histograms are converted to ROOT histograms only for writing. The
+// statistics of the ROOT histograms are then computed from the bin contents.
+template <typename Count = uint64_t> class CountingHistogram1D {
+  public:
+    CountingHistogram1D(const string name, const Histogram &x_properties)
+        : name(name), x_axis(x_properties),
+          counts(new Count[x_axis.n_bins + 2]()) {}
+
+    void fill(const double x) { increment(counts[x_axis.find_bin(x)]); }
+
+    uint64_t get_bin_content(const size_t bin) const {
+        return load(counts[bin]);
+    }
+
+    uint64_t get_entries() const {
+        uint64_t entries = 0;
+        for (size_t bin = 0; bin < x_axis.n_bins + 2; ++bin) {
+            entries += load(counts[bin]);
+        }
+        return entries;
+    }
+
+    void add(const CountingHistogram1D<Count> &histogram) {
+        for (size_t bin = 0; bin < x_axis.n_bins + 2; ++bin) {
+            counts[bin] += load(histogram.counts[bin]);
+        }
+    }
+
+    // Create a ROOT histogram (e.g. TH1D) with the same content.
+    // The caller takes ownership.
+    template <class T> T *to_root_histogram() const {
+        T *histogram =
+            new T(name.c_str(), name.c_str(), x_axis.n_bins,
+                  x_axis.lower_edge_of_first_bin, x_axis.upper_edge_of_last_bin);
+        for (size_t bin = 0; bin < x_axis.n_bins + 2; ++bin) {
+            if (load(counts[bin])) {
+                histogram->SetBinContent(bin, load(counts[bin]));
+            }
+        }
+        histogram->ResetStats();
+        histogram->SetEntries(get_entries());
+        return histogram;
+    }
+
+    // Write the histogram to the current directory as a ROOT histogram of type
+    // T.
+    template <class T> void write() const {
+        T *histogram = to_root_histogram<T>();
+        histogram->Write();
+        delete histogram;
+    }
+
+    const string name;
+    const UniformAxis x_axis;
+
+  private:
+    unique_ptr<Count[]> counts;
+};
+
+template <typename Count = uint64_t> class CountingHistogram2D {
+  public:
+    CountingHistogram2D(const string name, const Histogram &x_properties,
+                        const Histogram &y_properties)
+        : name(name), x_axis(x_properties), y_axis(y_properties),
+          counts(new Count[(x_axis.n_bins + 2) * (y_axis.n_bins + 2)]()) {}
+
+    void fill(const double x, const double y) {
+        increment(counts[get_bin(x_axis.find_bin(x), y_axis.find_bin(y))]);
+    }
+
+    size_t get_bin(const size_t x_bin, const size_t y_bin) const {
+        return x_bin + (x_axis.n_bins + 2) * y_bin;
+    }
+
+    uint64_t get_bin_content(const size_t x_bin, const size_t y_bin) const {
+        return load(counts[get_bin(x_bin, y_bin)]);
+    }
+
+    uint64_t get_entries() const {
+        uint64_t entries = 0;
+        for (size_t bin = 0; bin < get_n_bins(); ++bin) {
+            entries += load(counts[bin]);
+        }
+        return entries;
+    }
+
+    void add(const CountingHistogram2D<Count> &histogram) {
+        for (size_t bin = 0; bin < get_n_bins(); ++bin) {
+            counts[bin] += load(histogram.counts[bin]);
+        }
+    }
+
+    // Create a ROOT histogram (e.g. TH2I) with the same content.
+    // The caller takes ownership.
+    template <class T> T *to_root_histogram() const {
+        T *histogram =
+            new T(name.c_str(), name.c_str(), x_axis.n_bins,
+                  x_axis.lower_edge_of_first_bin, x_axis.upper_edge_of_last_bin,
+                  y_axis.n_bins, y_axis.lower_edge_of_first_bin,
+                  y_axis.upper_edge_of_last_bin);
+        for (size_t y_bin = 0; y_bin < y_axis.n_bins + 2; ++y_bin) {
+            for (size_t x_bin = 0; x_bin < x_axis.n_bins + 2; ++x_bin) {
+                if (get_bin_content(x_bin, y_bin)) {
+                    histogram->SetBinContent(x_bin, y_bin,
+                                             get_bin_content(x_bin, y_bin));
+                }
+            }
+        }
+        histogram->ResetStats();
+        histogram->SetEntries(get_entries());
+        return histogram;
+    }
+
+    // Write the histogram to the current directory as a ROOT histogram of type
+    // T.
+    template <class T> void write() const {
+        T *histogram = to_root_histogram<T>();
+        histogram->Write();
+        delete histogram;
+    }
+
+    const string name;
+    const UniformAxis x_axis, y_axis;
+
+  private:
+    size_t get_n_bins() const {
+        return (x_axis.n_bins + 2) * (y_axis.n_bins + 2);
+    }
+
+    unique_ptr<Count[]> counts;
+};
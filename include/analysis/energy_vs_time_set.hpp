@@ -0,0 +1,42 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+using std::vector;
+
+#include "analysis.hpp"
+#include "counting_histogram.hpp"
+
+// Set of the histograms of the calibrated energy versus the calibrated time of
+// all energy-sensitive detector channels, as created by 'energy_vs_time'.
+// The binnings of the detector groups are coarsened by the factors
+// rebin_energy and rebin_time.
+struct EnergyVsTimeSet {
+    EnergyVsTimeSet(const Analysis &analysis, const unsigned int rebin_energy,
+                    const unsigned int rebin_time);
+    EnergyVsTimeSet(const EnergyVsTimeSet &) = delete;
+    EnergyVsTimeSet &operator=(const EnergyVsTimeSet &) = delete;
+
+    vector<vector<CountingHistogram2D<>>> histograms;
+
+    void fill(const Analysis &analysis);
+    // Write all histograms to the current directory.
+    void write() const;
+};
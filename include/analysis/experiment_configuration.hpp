@@ -0,0 +1,188 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <string>
+
+using std::string;
+
+#include <type_traits>
+
+using std::is_arithmetic_v;
+
+#include <vector>
+
+using std::vector;
+
+#include "analysis.hpp"
+
+// Experiment configuration that is read from a JSON file at runtime, as an
+// alternative to a header in 'include/experiments', which has to be compiled
+// into all programs.
+//
+// The file has the same structure as the arguments of the Analysis
+// constructor. Detectors, groups and modules are referred to by their index:
+//
+// {
+//   "modules": [
+//     {"type": "MDPP16_SCP", "address": 0, "amplitude_branch": "amplitude",
+//      "time_branch": "time", "reference_time_branch": "reference_time",
+//      "timestamp_branch": "timestamp"},
+//     {"type": "SIS3316", "address": 1},
+//     {"type": "V830", "address": 2, "trigger_frequency": 5.0}
+//   ],
+//   "groups": [
+//     {"type": "energy_sensitive", "name": "clover",
+//      "histogram": [65536, -0.125, 16383.875],
+//      "raw_histogram": [65536, -0.5, 65535.5],
+//      "time_histogram": [2000, -1000.5, 999.5],
+//      "raw_time_histogram": [2000, -1000.5, 999.5]},
+//     {"type": "counter", "name": "counter", "histogram": [...],
+//      "raw_histogram": [...]}
+//   ],
+//   "detectors": [
+//     {"type": "energy_sensitive", "name": "clo1", "group": 0,
+//      "channels": [
+//        {"name": "E1", "module": 0, "channel": 0,
+//         "energy_calibration": [50.0, 0.1], "time_calibration": "0. 1.",
+//         "time_vs_reference_time_gate": [0.0, 20.0]}, ...],
+//      "addback_gates": [[[-2.5, 2.5], ...], ...]},
+//     {"type": "counter", "name": "cou", "group": 1,
+//      "channels": [{"name": "cts", "module": 2, "channel": 0}]}
+//   ],
+//   "coincidence_matrices": [
+//     {"name": "clo1_vs_clo2", "detectors_x": [0], "detectors_y": [1],
+//      "x_axis": [200, -5.0, 1995.0], "y_axis": [200, -5.0, 1995.0]}
+//   ]
+// }
+//
+// Calibrations are polynomials, given as an array of parameters or as a
+// string in the format of Polynomial. Gates are intervals [lower, upper].
+// A missing calibration is the identity, and a missing gate is open.
+// Since the Analysis is built from Polynomial, Gate and OpenGate objects, its
+// calibration kernels are the same as for an equivalent header, and the
+// calibration is as fast.
+// Custom calibrations or gates (lambdas) cannot be expressed in a file.
+//
+// Parsing a large configuration takes a noticeable time at the startup of
+// each program. Therefore, the parsed configuration is stored in a binary
+// cache file, which is used as long as the size and modification time (in
+// nanoseconds) of the JSON file do not change.
+
+struct HistogramConfiguration {
+    unsigned int n_bins;
+    double lower_edge_of_first_bin, upper_edge_of_last_bin;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(n_bins, lower_edge_of_first_bin, upper_edge_of_last_bin);
+    }
+};
+
+struct GateConfiguration {
+    bool open;
+    double lower_limit, upper_limit;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(open, lower_limit, upper_limit);
+    }
+};
+
+struct ModuleConfiguration {
+    string type;
+    unsigned int address;
+    string amplitude_branch, time_branch, reference_time_branch,
+        timestamp_branch;
+    double trigger_frequency;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(type, address, amplitude_branch, time_branch,
+                reference_time_branch, timestamp_branch, trigger_frequency);
+    }
+};
+
+struct GroupConfiguration {
+    string type, name;
+    HistogramConfiguration histogram, raw_histogram, time_histogram,
+        raw_time_histogram;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(type, name, histogram, raw_histogram, time_histogram,
+                raw_time_histogram);
+    }
+};
+
+struct ChannelConfiguration {
+    string name;
+    uint64_t module, channel;
+    vector<double> energy_calibration, time_calibration;
+    GateConfiguration time_vs_reference_time_gate;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(name, module, channel, energy_calibration, time_calibration,
+                time_vs_reference_time_gate);
+    }
+};
+
+struct DetectorConfiguration {
+    string type, name;
+    uint64_t group;
+    vector<ChannelConfiguration> channels;
+    vector<vector<GateConfiguration>> addback_gates;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(type, name, group, channels, addback_gates);
+    }
+};
+
+struct CoincidenceMatrixConfiguration {
+    string name;
+    vector<uint64_t> detectors_x, detectors_y;
+    HistogramConfiguration x_axis, y_axis;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(name, detectors_x, detectors_y, x_axis, y_axis);
+    }
+};
+
+struct ExperimentConfiguration {
+    vector<ModuleConfiguration> modules;
+    vector<GroupConfiguration> groups;
+    vector<DetectorConfiguration> detectors;
+    vector<CoincidenceMatrixConfiguration> coincidence_matrices;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(modules, groups, detectors, coincidence_matrices);
+    }
+
+    // Aborts if the file cannot be parsed.
+    void read_json(const string &file_name);
+    // Return false if the cache does not exist, or if it does not belong to
+    // the current version of the JSON file.
+    bool read_cache(const string &cache_file_name, const string &file_name);
+    void write_cache(const string &cache_file_name, const string &file_name);
+    Analysis create_analysis() const;
+};
+
+// Reads the configuration from the cache if it is up to date, otherwise from
+// the JSON file, and (re)creates the cache.
+// By default, the cache is stored next to the JSON file, with the suffix
+// '.cache'.
+Analysis load_analysis(const string &file_name,
+                       const string &cache_file_name = "");
@@ -0,0 +1,116 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+
+using std::unique_ptr;
+
+#include <set>
+
+using std::set;
+
+#include <string>
+
+using std::string;
+
+#include <utility>
+
+using std::pair;
+
+#include <vector>
+
+using std::vector;
+
+#include "TFile.h"
+#include "TH1D.h"
+
+#include "analysis.hpp"
+#include "counting_histogram.hpp"
+
+// Selection of the pairs of energy-sensitive channels for which time-difference
+// histograms are created.
+//
+// The selection is given as a string:
+//  'all': all pairs of channels
+//  'detector': only pairs of channels of the same detector
+//  'group': only pairs of channels of detectors in the same group
+// Any other string is interpreted as the name of a text file that lists the
+// selected pairs, one per line, as two channel names of the form
+// '<detector>_<channel>' separated by whitespace.
+struct TimeDifferencePairSelection {
+    enum class Mode { all, same_detector, same_group, list };
+
+    TimeDifferencePairSelection(const string selection = "all");
+
+    bool is_selected(const Analysis &analysis, const size_t n_detector_1,
+                     const size_t n_channel_1, const size_t n_detector_2,
+                     const size_t n_channel_2) const;
+
+    Mode mode;
+    set<pair<string, string>> pairs;
+};
+
+// Set of all one-dimensional histograms that 'histograms_1d' creates for a
+// given analysis.
+// The histograms are counting histograms, which are converted to TH1D only
+// when they are written. Sets with identical histogram names can be filled in
+// parallel and merged afterwards.
+//
+// The time-difference histograms are created on their first fill, and only for
+// the pairs of channels that are selected. Pairs that are never filled do not
+// use memory and are not written to the output file.
+struct HistogramSet1D {
+    HistogramSet1D(const Analysis &analysis,
+                   const TimeDifferencePairSelection &time_difference_pairs =
+                       TimeDifferencePairSelection());
+    HistogramSet1D(const HistogramSet1D &) = delete;
+    HistogramSet1D &operator=(const HistogramSet1D &) = delete;
+
+    // A nullptr for detectors with a single channel.
+    vector<unique_ptr<CountingHistogram1D<>>> addback_histograms;
+    vector<vector<CountingHistogram1D<>>> energy_sensitive_detector_histograms;
+    vector<vector<CountingHistogram1D<>>> counter_detector_histograms;
+    vector<vector<CountingHistogram1D<>>> time_vs_reference_time_histograms;
+    // Indexed as [n_detector_1][n_channel_1][n_detector_2 -
+    // n_detector_1][n_channel_2], where only pairs with n_detector_2 >=
+    // n_detector_1 exist. For n_detector_2 == n_detector_1, the last index is
+    // n_channel_2 - n_channel_1 - 1.
+    // A nullptr means that the pair was not filled (yet).
+    vector<vector<vector<vector<unique_ptr<CountingHistogram1D<>>>>>>
+        time_difference_histograms;
+    vector<vector<vector<vector<bool>>>> time_difference_selected;
+
+    void add(const HistogramSet1D &histogram_set);
+    // Fills the histograms with the channels in the hit list of the
+    // calibrated channel table of the analysis (see Analysis::update_hits()).
+    void fill(const Analysis &analysis);
+    void write(const Analysis &analysis, TFile &output_file) const;
+
+  private:
+    void fill_time_difference(const size_t n_detector_1,
+                              const size_t n_channel_1,
+                              const size_t n_detector_offset,
+                              const size_t n_channel_2, const double value);
+
+    // Names of the channels, indexed as [n_detector][n_channel], and binnings
+    // of the time-difference histograms, indexed as [n_detector_1][n_detector_2
+    // - n_detector_1], for the creation of the time-difference histograms.
+    vector<vector<string>> channel_names;
+    vector<vector<Histogram>> time_difference_binnings;
+};
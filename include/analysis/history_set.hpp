@@ -0,0 +1,43 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+using std::vector;
+
+#include "analysis.hpp"
+#include "counting_histogram.hpp"
+
+// Set of the histograms of the calibrated energies of all energy-sensitive
+// detector channels and the count rates of all counter detector channels
+// versus the entry number, as created by 'history'.
+// The entries [first, last] are divided into 256 bins.
+struct HistorySet {
+    HistorySet(const Analysis &analysis, const long long first,
+               const long long last);
+    HistorySet(const HistorySet &) = delete;
+    HistorySet &operator=(const HistorySet &) = delete;
+
+    vector<vector<CountingHistogram2D<>>> energy_sensitive_detector_histograms;
+    vector<vector<CountingHistogram2D<>>> counter_detector_histograms;
+
+    void fill(const Analysis &analysis, const long long n_entry);
+    // Write all histograms to the current directory.
+    void write() const;
+};
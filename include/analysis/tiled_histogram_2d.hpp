@@ -0,0 +1,104 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+
+using std::array;
+
+#include <cstdint>
+
+#include <memory>
+
+using std::make_unique;
+using std::unique_ptr;
+
+#include <string>
+
+using std::string;
+
+#include <vector>
+
+using std::vector;
+
+#include "TH2I.h"
+#include "THnSparse.h"
+
+#include "counting_histogram.hpp"
+#include "histogram_properties.hpp"
+
+// Two-dimensional counting histogram whose memory scales with the filled area
+// instead of the number of bins.
+//
+// The bins (including the underflow and overflow bins) are grouped into square
+// tiles of tile_size x tile_size bins. A tile is allocated on the first fill
+// of one of its bins.
+// This allows, for example, gamma-gamma coincidence matrices with the full
+// resolution of the spectra: a dense 65536 x 65536 matrix would need 16 GB,
+// while the tiles of a matrix where the coincidences are concentrated near
+// the diagonal and on a few lines only need a small fraction of that.
+// The histogram is written as a THnSparseI by default. Writing it as a TH2I
+// allocates all bins of the matrix at once, so the memory usage at that point
+// is the same as for a dense matrix.
+class TiledHistogram2D {
+  public:
+    static constexpr size_t tile_size = 64;
+
+    TiledHistogram2D(const string name, const Histogram &x_properties,
+                     const Histogram &y_properties);
+
+    void fill(const double x, const double y) {
+        const size_t x_bin = x_axis.find_bin(x);
+        const size_t y_bin = y_axis.find_bin(y);
+        unique_ptr<Tile> &tile =
+            tiles[(y_bin / tile_size) * n_tiles_x + x_bin / tile_size];
+        if (tile == nullptr) {
+            tile = make_unique<Tile>();
+        }
+        ++(*tile)[(y_bin % tile_size) * tile_size + x_bin % tile_size];
+        ++n_entries;
+    }
+
+    uint64_t get_bin_content(const size_t x_bin, const size_t y_bin) const;
+    uint64_t get_entries() const { return n_entries; }
+    size_t get_n_allocated_tiles() const;
+    // Approximate memory usage in bytes.
+    size_t get_memory_usage() const;
+
+    // Add the content of a histogram with the same binning, for example one
+    // that was filled by another thread.
+    void add(const TiledHistogram2D &histogram);
+
+    // Create a ROOT histogram with the same content. The caller takes
+    // ownership.
+    THnSparseI *to_THnSparse() const;
+    TH2I *to_TH2I() const;
+    // Write the histogram to the current directory as a THnSparseI if sparse
+    // is set, otherwise as a TH2I.
+    void write(const bool sparse = true) const;
+
+    const string name;
+    const UniformAxis x_axis, y_axis;
+
+  private:
+    typedef array<uint32_t, tile_size * tile_size> Tile;
+
+    const size_t n_tiles_x, n_tiles_y;
+    vector<unique_ptr<Tile>> tiles;
+    uint64_t n_entries;
+};
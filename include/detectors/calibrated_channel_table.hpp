@@ -0,0 +1,123 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <limits>
+
+using std::numeric_limits;
+
+#include <vector>
+
+using std::vector;
+
+// Calibrated quantities of all energy-sensitive detector channels of an
+// analysis.
+// Each quantity is stored in a contiguous array that is indexed by a global
+// channel index, so that loops over all channels access memory linearly.
+struct CalibratedChannelTable {
+    CalibratedChannelTable(const size_t n_channels)
+        : energy(n_channels, numeric_limits<double>::quiet_NaN()),
+          time(n_channels, numeric_limits<double>::quiet_NaN()),
+          timestamp(n_channels, numeric_limits<double>::quiet_NaN()),
+          time_vs_reference_time(n_channels,
+                                 numeric_limits<double>::quiet_NaN()),
+          valid((n_channels + 63) / 64, 0),
+          written((n_channels + 63) / 64, 0) {
+        hits.reserve(n_channels);
+    }
+
+    vector<double> energy;
+    vector<double> time;
+    vector<double> timestamp;
+    vector<double> time_vs_reference_time;
+    // Bit (n_channel % 64) of valid[n_channel / 64] is set if the channel
+    // has a calibrated energy that passes its time-vs-reference-time gate.
+    vector<uint64_t> valid;
+    // Indices of the valid channels in ascending order ('hit list').
+    // Typical events have only a few valid channels, so loops over pairs of
+    // valid channels should iterate over this list instead of over all
+    // channels. It is only up to date after update_hits().
+    vector<size_t> hits;
+    // Bit (n_channel % 64) of written[n_channel / 64] is set if a quantity of
+    // the channel was written since the last reset, i.e. if it may be
+    // different from NaN. The resets only touch those channels.
+    // If the quantities are written without calling mark_written(), for
+    // example by TTree::GetEntry(), untracked_writes has to be set, and all
+    // channels are reset.
+    vector<uint64_t> written;
+    bool untracked_writes = false;
+
+    size_t size() const { return energy.size(); }
+
+    bool is_valid(const size_t n_channel) const {
+        return (valid[n_channel / 64] >> (n_channel % 64)) & 1;
+    }
+    void set_valid(const size_t n_channel, const bool is_valid) {
+        valid[n_channel / 64] =
+            (valid[n_channel / 64] & ~(uint64_t(1) << (n_channel % 64))) |
+            (uint64_t(is_valid) << (n_channel % 64));
+    }
+
+    bool is_written(const size_t n_channel) const {
+        return untracked_writes ||
+               ((written[n_channel / 64] >> (n_channel % 64)) & 1);
+    }
+    void mark_written(const size_t n_channel) {
+        written[n_channel / 64] |= uint64_t(1) << (n_channel % 64);
+    }
+
+    void update_hits() {
+        hits.clear();
+        for (size_t n_word = 0; n_word < valid.size(); ++n_word) {
+            for (uint64_t bits = valid[n_word]; bits != 0; bits &= bits - 1) {
+                hits.push_back(n_word * 64 + __builtin_ctzll(bits));
+            }
+        }
+    }
+
+    void reset(const size_t n_channel) {
+        energy[n_channel] = numeric_limits<double>::quiet_NaN();
+        time[n_channel] = numeric_limits<double>::quiet_NaN();
+        timestamp[n_channel] = numeric_limits<double>::quiet_NaN();
+        time_vs_reference_time[n_channel] = numeric_limits<double>::quiet_NaN();
+        set_valid(n_channel, false);
+        written[n_channel / 64] &= ~(uint64_t(1) << (n_channel % 64));
+    }
+    void reset() {
+        for (size_t n_word = 0; n_word < written.size(); ++n_word) {
+            const uint64_t channels =
+                untracked_writes ? ~uint64_t(0) : written[n_word];
+            for (uint64_t bits = channels; bits != 0; bits &= bits - 1) {
+                const size_t n_channel = n_word * 64 + __builtin_ctzll(bits);
+                if (n_channel >= size()) {
+                    break;
+                }
+                energy[n_channel] = numeric_limits<double>::quiet_NaN();
+                time[n_channel] = numeric_limits<double>::quiet_NaN();
+                timestamp[n_channel] = numeric_limits<double>::quiet_NaN();
+                time_vs_reference_time[n_channel] =
+                    numeric_limits<double>::quiet_NaN();
+            }
+            written[n_word] = 0;
+            valid[n_word] = 0;
+        }
+        hits.clear();
+    }
+};
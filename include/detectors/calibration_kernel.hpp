@@ -0,0 +1,137 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+
+using std::function;
+
+#include "energy_sensitive_detector_channel.hpp"
+#include "gate.hpp"
+#include "polynomial.hpp"
+
+// Coefficients of a calibration polynomial, stored in a fixed-size array so
+// that it can be evaluated without an indirect call.
+// If n_parameters is zero, the calibration is not a (sufficiently short)
+// Polynomial and has to be evaluated by calling the std::function.
+struct PolynomialKernel {
+    static constexpr size_t max_n_parameters = 4;
+
+    template <typename... Arguments>
+    PolynomialKernel(const function<double(Arguments...)> &calibration)
+        : n_parameters(0), parameters{} {
+        const Polynomial *polynomial =
+            calibration.template target<Polynomial>();
+        if (polynomial != nullptr && !polynomial->parameters.empty() &&
+            polynomial->parameters.size() <= max_n_parameters) {
+            n_parameters = polynomial->parameters.size();
+            for (size_t i = 0; i < n_parameters; ++i) {
+                parameters[i] = polynomial->parameters[i];
+            }
+        }
+    }
+
+    size_t n_parameters;
+    double parameters[max_n_parameters];
+
+    // Same order of operations as Polynomial::operator(), so that both give
+    // identical results.
+    double operator()(const double x) const {
+        double result = parameters[n_parameters - 1];
+        for (size_t i = n_parameters - 1; i > 0; --i) {
+            result = parameters[i - 1] + result * x;
+        }
+        return result;
+    }
+
+    // Same as operator(), but with a number of parameters that is known at
+    // compile time, so that the loop can be unrolled.
+    template <size_t n> double evaluate(const double x) const {
+        double result = parameters[n - 1];
+        for (size_t i = n - 1; i > 0; --i) {
+            result = parameters[i - 1] + result * x;
+        }
+        return result;
+    }
+};
+
+// Interval of a time-vs-reference-time gate.
+// Gates that are neither a Gate nor an OpenGate have to be evaluated by
+// calling the std::function.
+struct GateKernel {
+    enum class Type { open, interval, custom };
+
+    GateKernel(const function<bool(const double)> &gate)
+        : type(Type::custom), lower_limit(0.), upper_limit(0.) {
+        if (gate.target<OpenGate>() != nullptr) {
+            type = Type::open;
+        } else if (gate.target<Gate>() != nullptr) {
+            type = Type::interval;
+            lower_limit = gate.target<Gate>()->lower_limit;
+            upper_limit = gate.target<Gate>()->upper_limit;
+        }
+    }
+
+    Type type;
+    double lower_limit, upper_limit;
+};
+
+// Plain-data representation of the calibration of an energy-sensitive
+// detector channel.
+// Analysis builds one kernel per channel and uses it in the calibration loop.
+// Custom calibrations fall back to the std::function objects of the channel.
+struct CalibrationKernel {
+    CalibrationKernel(const EnergySensitiveDetectorChannel &channel)
+        : energy(channel.energy_calibration), time(channel.time_calibration),
+          gate(channel.time_vs_reference_time_gate) {}
+
+    PolynomialKernel energy;
+    PolynomialKernel time;
+    GateKernel gate;
+
+    double calibrate_energy(const EnergySensitiveDetectorChannel &channel,
+                            const double amplitude,
+                            const long long n_entry) const {
+        if (energy.n_parameters) {
+            return energy(amplitude);
+        }
+        return channel.energy_calibration(amplitude, n_entry);
+    }
+
+    double calibrate_time(const EnergySensitiveDetectorChannel &channel,
+                          const double raw_time, const double energy) const {
+        if (time.n_parameters) {
+            return time(raw_time);
+        }
+        return channel.time_calibration(raw_time, energy);
+    }
+
+    bool
+    time_vs_reference_time_gate(const EnergySensitiveDetectorChannel &channel,
+                                const double time_vs_reference_time) const {
+        switch (gate.type) {
+        case GateKernel::Type::open:
+            return true;
+        case GateKernel::Type::interval:
+            return (time_vs_reference_time > gate.lower_limit) &&
+                   (time_vs_reference_time < gate.upper_limit);
+        default:
+            return channel.time_vs_reference_time_gate(time_vs_reference_time);
+        }
+    }
+};
@@ -17,6 +17,10 @@
 
 #pragma once
 
+#include <memory>
+
+using std::make_shared;
+
 #include "counter_detector_channel.hpp"
 #include "detector.hpp"
 
@@ -27,6 +31,9 @@ struct CounterDetector final : public Detector {
 
     vector<CounterDetectorChannel> channels;
 
+    shared_ptr<Detector> clone() const override final {
+        return make_shared<CounterDetector>(*this);
+    }
     void set_up_calibrated_branches_for_reading(TTree *tree) override final;
     void set_up_calibrated_branches_for_writing(TTree *tree) override final;
     void reset_calibrated_leaves() override final;
@@ -36,6 +36,7 @@ struct Detector {
     const string name;
     const size_t group;
 
+    virtual shared_ptr<Detector> clone() const = 0;
     virtual void reset_calibrated_leaves() = 0;
     virtual void set_up_calibrated_branches_for_reading(TTree *tree) = 0;
     virtual void set_up_calibrated_branches_for_writing(TTree *tree) = 0;
@@ -17,6 +17,16 @@
 
 #pragma once
 
+#include <array>
+
+using std::array;
+
+#include <cstdint>
+
+#include <memory>
+
+using std::make_shared;
+
 #include <string>
 
 using std::string;
@@ -29,10 +39,15 @@ using std::pair;
 
 using std::vector;
 
+#include "calibration_kernel.hpp"
 #include "detector.hpp"
 #include "energy_sensitive_detector_channel.hpp"
 
 struct EnergySensitiveDetector final : public Detector {
+    // The channels of a detector are represented by the bits of a uint32_t,
+    // which limits their number.
+    static constexpr size_t max_n_channels = 32;
+
     EnergySensitiveDetector(
         const string name,
         const vector<EnergySensitiveDetectorChannel> channels,
@@ -43,19 +58,37 @@ struct EnergySensitiveDetector final : public Detector {
     vector<EnergySensitiveDetectorChannel> channels;
 
     vector<vector<function<bool(const double)>>> addback_coincidence_gates;
+    // Compiled addback_coincidence_gates, indexed as
+    // [n_c_0 * channels.size() + n_c_1] with n_c_1 > n_c_0.
+    vector<GateKernel> addback_gate_kernels;
 
-    vector<bool> skip_channel;
-    vector<double> addback_energies;
-    vector<double> addback_times;
+    // Summed energy and time of each addback cluster, indexed by the first
+    // channel of the cluster.
+    // Only the entries of the clusters of the current event are used, so the
+    // arrays do not have to be reset between events.
+    array<double, max_n_channels> addback_energies;
+    array<double, max_n_channels> addback_times;
 
     double addback_energy;
     double addback_time;
     double addback_time_vs_reference_time;
 
+    shared_ptr<Detector> clone() const override final {
+        return make_shared<EnergySensitiveDetector>(*this);
+    }
+    // Bit n_channel is set if the channel has a calibrated energy.
+    uint32_t get_hit_mask() const;
     void addback();
-    void filter_addback();
+    bool addback_gate(const size_t n_c_0, const size_t n_c_1,
+                      const double time_difference) const;
+    // Sets the addback quantities to those of the cluster with the highest
+    // energy. The bits of first_channels are the first channels of the
+    // clusters.
+    void filter_addback(const uint32_t first_channels);
     double get_calibrated_and_RF_gated_energy() const;
     void reset_calibrated_leaves() override final;
+    // Resets only the addback quantities, not the calibrated channel leaves.
+    void reset_addback();
     void set_up_calibrated_branches_for_reading(TTree *tree) override final;
     void set_up_calibrated_branches_for_writing(TTree *tree) override final;
 };
\ No newline at end of file
@@ -21,9 +21,9 @@
 
 using std::function;
 
-#include <limits>
+#include <memory>
 
-using std::numeric_limits;
+using std::shared_ptr;
 
 #include <string>
 
@@ -33,32 +33,61 @@ using std::string;
 
 using std::vector;
 
+#include "calibrated_channel_table.hpp"
 #include "channel.hpp"
+#include "gate.hpp"
+#include "polynomial.hpp"
 
 struct EnergySensitiveDetectorChannel final : public Channel {
     EnergySensitiveDetectorChannel(
         const string name, const size_t module, const size_t channel,
         const function<double(const double, const long long)>
-            energy_calibration =
-                [](const double amplitude,
-                   [[maybe_unused]] const long long n_entry) {
-                    return amplitude;
-                },
+            energy_calibration = Polynomial(vector<double>{0., 1.}),
         const function<double(const double, const double)> time_calibration =
-            [](const double raw_time, [[maybe_unused]] const double energy) {
-                return raw_time;
-            },
+            Polynomial(vector<double>{0., 1.}),
         const function<bool(const double)> time_vs_reference_time_gate =
-            []([[maybe_unused]] const double time_vs_reference_time) {
-                return true;
-            });
+            OpenGate());
 
     const function<double(const double, const long long)> energy_calibration;
     const function<double(const double, const double)> time_calibration;
     const function<bool(const double)> time_vs_reference_time_gate;
 
-    double energy_calibrated, time_calibrated, timestamp_calibrated,
-        time_vs_reference_time_calibrated;
+    // The calibrated quantities of a channel are views into an entry of a
+    // CalibratedChannelTable.
+    // On construction, a channel owns a table with a single entry.
+    // An Analysis rebinds all of its channels to a common table.
+    shared_ptr<CalibratedChannelTable> calibrated_channel_table;
+    size_t calibrated_channel_index;
+
+    void bind_calibrated_channel_table(shared_ptr<CalibratedChannelTable> table,
+                                       const size_t index);
+
+    double &energy_calibrated() {
+        return calibrated_channel_table->energy[calibrated_channel_index];
+    }
+    double energy_calibrated() const {
+        return calibrated_channel_table->energy[calibrated_channel_index];
+    }
+    double &time_calibrated() {
+        return calibrated_channel_table->time[calibrated_channel_index];
+    }
+    double time_calibrated() const {
+        return calibrated_channel_table->time[calibrated_channel_index];
+    }
+    double &timestamp_calibrated() {
+        return calibrated_channel_table->timestamp[calibrated_channel_index];
+    }
+    double timestamp_calibrated() const {
+        return calibrated_channel_table->timestamp[calibrated_channel_index];
+    }
+    double &time_vs_reference_time_calibrated() {
+        return calibrated_channel_table
+            ->time_vs_reference_time[calibrated_channel_index];
+    }
+    double time_vs_reference_time_calibrated() const {
+        return calibrated_channel_table
+            ->time_vs_reference_time[calibrated_channel_index];
+    }
 
     void reset_calibrated_leaves() override final;
 };
@@ -0,0 +1,40 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdlib>
+
+using std::getenv;
+
+#include <string>
+
+using std::string;
+
+#include "analysis_include.hpp"
+#include "experiment_configuration.hpp"
+
+// Analysis that is read from a JSON file at the startup of each program (see
+// experiment_configuration.hpp).
+// The file is given by the environment variable CAROLINA_EXPERIMENT, and
+// defaults to 'experiment.json' in the working directory.
+inline string get_experiment_configuration_file_name() {
+    const char *file_name = getenv("CAROLINA_EXPERIMENT");
+    return file_name != nullptr ? file_name : "experiment.json";
+}
+
+Analysis analysis(load_analysis(get_experiment_configuration_file_name()));
@@ -0,0 +1,127 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <sys/stat.h>
+
+#include <cstdint>
+
+#include <fstream>
+
+using std::ifstream;
+using std::ios;
+using std::ofstream;
+
+#include <string>
+
+using std::string;
+
+#include <type_traits>
+
+using std::is_arithmetic_v;
+
+#include <vector>
+
+using std::vector;
+
+// Archives for the serialize() functions of cached data structures, which
+// write and read arithmetic types in the native representation, and strings
+// and vectors as their size followed by the elements.
+struct BinaryWriter {
+    BinaryWriter(ofstream &file) : file(file) {}
+    ofstream &file;
+
+    template <typename... T> void operator()(T &...values) {
+        (process(values), ...);
+    }
+    template <typename T> void process(T &value) {
+        if constexpr (is_arithmetic_v<T>) {
+            file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        } else {
+            value.serialize(*this);
+        }
+    }
+    void process(string &value) {
+        uint64_t size = value.size();
+        process(size);
+        file.write(value.data(), size);
+    }
+    template <typename T> void process(vector<T> &values) {
+        uint64_t size = values.size();
+        process(size);
+        for (auto &value : values) {
+            process(value);
+        }
+    }
+};
+
+struct BinaryReader {
+    BinaryReader(ifstream &file) : file(file) {}
+    ifstream &file;
+    // Protects against huge allocations if the file is corrupted.
+    static constexpr uint64_t max_size = 1 << 24;
+
+    template <typename... T> void operator()(T &...values) {
+        (process(values), ...);
+    }
+    template <typename T> void process(T &value) {
+        if constexpr (is_arithmetic_v<T>) {
+            file.read(reinterpret_cast<char *>(&value), sizeof(T));
+        } else {
+            value.serialize(*this);
+        }
+    }
+    void process(string &value) {
+        uint64_t size = read_size();
+        value.resize(size);
+        file.read(value.data(), size);
+    }
+    template <typename T> void process(vector<T> &values) {
+        values.resize(read_size());
+        for (auto &value : values) {
+            process(value);
+        }
+    }
+    uint64_t read_size() {
+        uint64_t size = 0;
+        process(size);
+        if (size > max_size) {
+            file.setstate(ios::failbit);
+            return 0;
+        }
+        return size;
+    }
+};
+
+// Size and modification time of a file, which identify the version of the
+// file that a cache belongs to.
+// The modification time is given in nanoseconds, because an edit of a
+// configuration often keeps the size of the file, and may happen within the
+// same second as the creation of the cache.
+inline bool get_file_version(const string &file_name, int64_t &size,
+                             int64_t &modification_time) {
+    struct stat file_status;
+    if (stat(file_name.c_str(), &file_status)) {
+        return false;
+    }
+    size = file_status.st_size;
+    modification_time =
+        int64_t(file_status.st_mtim.tv_sec) * 1000000000 +
+        file_status.st_mtim.tv_nsec;
+    return true;
+}
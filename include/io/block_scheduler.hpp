@@ -0,0 +1,33 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+
+using std::function;
+
+// Call process_block(n_block, n_thread) for every n_block in [0, n_blocks),
+// distributing the blocks dynamically over n_threads worker threads.
+// n_thread is the index of the worker that processes the block, so that
+// callers can keep one private set of state per thread.
+// With n_threads <= 1, all blocks are processed in order on the calling
+// thread.
+void process_blocks_in_parallel(
+    const size_t n_blocks, const unsigned int n_threads,
+    const function<void(const size_t n_block, const unsigned int n_thread)>
+        process_block);
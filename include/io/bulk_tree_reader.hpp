@@ -0,0 +1,71 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+
+using std::unique_ptr;
+
+#include <vector>
+
+using std::vector;
+
+#include "TBranch.h"
+#include "TBufferFile.h"
+#include "TChain.h"
+
+// Replacement for TChain::GetEntry() that reads the active branches basket by
+// basket instead of entry by entry.
+//
+// For each active branch with a single fixed-size leaf, the basket that
+// contains the requested entry is deserialized as a whole into a column with
+// ROOT's bulk I/O (TBranch::GetBulkRead()).
+// Subsequent entries from the same basket are copied from this column into the
+// address of the branch, without going through the per-entry streaming of
+// TBranch::GetEntry().
+// Branches that do not support bulk reads fall back to TBranch::GetEntry().
+// If bulk is false, get_entry() simply calls TChain::GetEntry().
+//
+// The branches and their addresses must be set up before the first call of
+// get_entry().
+class BulkTreeReader {
+  public:
+    BulkTreeReader(TChain *tree, const bool bulk = true)
+        : tree(tree), bulk(bulk), tree_number(-1){};
+
+    void get_entry(const long long entry);
+
+  private:
+    struct Column {
+        TBranch *branch;
+        char *address;
+        size_t entry_size;
+        bool bulk;
+        unique_ptr<TBufferFile> buffer;
+        const char *data;
+        long long first_entry, n_entries;
+    };
+
+    void set_up_columns();
+    void read_basket(Column &column, const long long local_entry);
+
+    TChain *tree;
+    const bool bulk;
+    int tree_number;
+    vector<Column> columns;
+};
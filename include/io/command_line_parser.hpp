@@ -25,6 +25,8 @@ using std::string;
 
 #include "TChain.h"
 
+#include "tree_cache.hpp"
+
 namespace po = boost::program_options;
 
 class CommandLineParser {
@@ -35,6 +37,7 @@ class CommandLineParser {
     po::variables_map get_variables_map() const { return vm; };
     TChain *set_up_tree(long long &first, long long &last,
                         const bool log_file = false) const;
+    TreeCache get_tree_cache() const;
 
     po::options_description desc;
 
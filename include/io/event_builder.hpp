@@ -0,0 +1,150 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include <functional>
+
+using std::greater;
+
+#include <queue>
+
+using std::priority_queue;
+
+#include <utility>
+
+using std::pair;
+
+#include <vector>
+
+using std::vector;
+
+// Data words of a single module that follow a module header in a listfile,
+// together with the timestamp of the module.
+// The words are not copied, so they have to stay valid (e.g. in a memory
+// mapping of the listfile) until the frame has been processed.
+struct ModuleFrame {
+    uint64_t timestamp;
+    const uint32_t *words;
+    uint32_t n_words;
+    uint32_t module;
+};
+
+// Merges the frames of several modules, which arrive in the order in which
+// the modules were read out, into events ordered by timestamp.
+//
+// The frames of each module are buffered in a ring buffer with a fixed
+// capacity, in which they are assumed to be ordered by timestamp.
+// A min-heap contains the first frame of each non-empty buffer.
+// An event consists of the earliest frame and the first frames of all other
+// modules whose timestamps are at most 'window' larger, i.e. each module
+// contributes at most one frame to an event.
+//
+// An event can only be built if no frame with an earlier timestamp can arrive
+// any more. Therefore, the builder waits until each module has at least one
+// buffered frame. Modules that send no or only few frames would block the
+// builder, so an event is also built as soon as the buffer of any module is
+// full. This bounds the memory usage, at the cost of splitting events if the
+// readout of a module lags behind the others by more than 'capacity' frames.
+// Frames that arrive after an event with a later timestamp has been built are
+// counted in n_late_frames.
+class EventBuilder {
+  public:
+    EventBuilder(const size_t n_modules, const uint64_t window,
+                 const size_t capacity = 1024)
+        : window(window), capacity(capacity),
+          buffers(n_modules, vector<ModuleFrame>(capacity)),
+          heads(n_modules, 0), sizes(n_modules, 0), n_non_empty_buffers(0),
+          n_full_buffers(0), n_frames(0), last_event_timestamp(0),
+          n_late_frames(0) {}
+
+    // Must not be called if is_ready() is true, because the buffer of the
+    // module could be full.
+    void push(const ModuleFrame &frame) {
+        const uint32_t module = frame.module;
+        if (frame.timestamp < last_event_timestamp) {
+            ++n_late_frames;
+        }
+        buffers[module][(heads[module] + sizes[module]) % capacity] = frame;
+        if (++sizes[module] == 1) {
+            ++n_non_empty_buffers;
+            heap.push({frame.timestamp, module});
+        }
+        if (sizes[module] == capacity) {
+            ++n_full_buffers;
+        }
+        ++n_frames;
+    }
+
+    // True if an event can be built without waiting for more frames.
+    // At the end of the input, call build_event() until empty() is true.
+    bool is_ready() const {
+        return n_full_buffers > 0 || n_non_empty_buffers == buffers.size();
+    }
+
+    bool empty() const { return n_frames == 0; }
+
+    // Removes the frames of the next event from the buffers and stores them in
+    // 'event', ordered by timestamp.
+    void build_event(vector<ModuleFrame> &event) {
+        event.clear();
+        if (heap.empty()) {
+            return;
+        }
+        const uint64_t first_timestamp = heap.top().first;
+        last_event_timestamp = first_timestamp;
+        while (!heap.empty() && heap.top().first - first_timestamp <= window) {
+            const uint32_t module = heap.top().second;
+            heap.pop();
+            event.push_back(buffers[module][heads[module]]);
+            if (sizes[module] == capacity) {
+                --n_full_buffers;
+            }
+            heads[module] = (heads[module] + 1) % capacity;
+            --sizes[module];
+            --n_frames;
+        }
+        // The next frames of the modules in the event are added to the heap
+        // only now, so that no module contributes twice.
+        for (const auto &frame : event) {
+            if (sizes[frame.module] > 0) {
+                heap.push({buffers[frame.module][heads[frame.module]].timestamp,
+                           frame.module});
+            } else {
+                --n_non_empty_buffers;
+            }
+        }
+    }
+
+    size_t get_n_late_frames() const { return n_late_frames; }
+
+    const uint64_t window;
+    const size_t capacity;
+
+  private:
+    vector<vector<ModuleFrame>> buffers;
+    vector<size_t> heads, sizes;
+    size_t n_non_empty_buffers, n_full_buffers, n_frames;
+    uint64_t last_event_timestamp;
+    size_t n_late_frames;
+    priority_queue<pair<uint64_t, uint32_t>,
+                   vector<pair<uint64_t, uint32_t>>,
+                   greater<pair<uint64_t, uint32_t>>>
+        heap;
+};
@@ -17,6 +17,10 @@
 
 #pragma once
 
+#include <chrono>
+
+using std::chrono::steady_clock;
+
 #include <string>
 
 using std::string;
@@ -35,6 +39,8 @@ class ProgressPrinter {
     char *get_time_string() const;
 
     const time_t start_time;
+    const steady_clock::time_point start_time_point;
+    const string unit_plural;
     const long long first, last, n_entries;
     const double inverse_n_entries, update_increment;
     double current_percentage;
@@ -0,0 +1,94 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+
+using std::atomic;
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::memory_order_release;
+
+#include <cstddef>
+
+#include <thread>
+
+using std::this_thread::yield;
+
+#include <vector>
+
+using std::vector;
+
+// Bounded lock-free queue for exactly one thread that pushes and one thread
+// that pops items.
+// Each index is only written by one of the threads, so the synchronization
+// reduces to a release store of the own index and an acquire load of the
+// other one.
+// The indices are kept on separate cache lines, so that the two threads do
+// not invalidate each other's cache line at each operation.
+template <typename T> class SPSCQueue {
+  public:
+    explicit SPSCQueue(const size_t capacity)
+        : buffer(capacity + 1), head(0), tail(0) {}
+
+    // Returns false if the queue is full.
+    bool try_push(const T &item) {
+        const size_t current_tail = tail.load(memory_order_relaxed);
+        const size_t next_tail = increment(current_tail);
+        if (next_tail == head.load(memory_order_acquire)) {
+            return false;
+        }
+        buffer[current_tail] = item;
+        tail.store(next_tail, memory_order_release);
+        return true;
+    }
+
+    // Returns false if the queue is empty.
+    bool try_pop(T &item) {
+        const size_t current_head = head.load(memory_order_relaxed);
+        if (current_head == tail.load(memory_order_acquire)) {
+            return false;
+        }
+        item = buffer[current_head];
+        head.store(increment(current_head), memory_order_release);
+        return true;
+    }
+
+    // Blocking versions, which yield the processor while waiting.
+    void push(const T &item) {
+        while (!try_push(item)) {
+            yield();
+        }
+    }
+
+    void pop(T &item) {
+        while (!try_pop(item)) {
+            yield();
+        }
+    }
+
+  private:
+    size_t increment(const size_t index) const {
+        return index + 1 == buffer.size() ? 0 : index + 1;
+    }
+
+    // One slot stays empty to distinguish a full from an empty queue.
+    vector<T> buffer;
+    alignas(64) atomic<size_t> head;
+    alignas(64) atomic<size_t> tail;
+};
@@ -0,0 +1,53 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "TTree.h"
+
+// Configuration of ROOT's read cache (TTreeCache) for an input tree.
+//
+// Without a cache, every basket is fetched with a separate read call, which
+// is slow on network file systems.
+// The cache collects the baskets of all branches that are read into a few
+// large reads.
+class TreeCache {
+  public:
+    // cache_mb < 0: keep the default cache size of ROOT.
+    // cache_mb = 0: disable the cache.
+    // learn_entries = 0: only cache the active branches, do not try to learn
+    // which other branches are used.
+    // prefetch: read the next block of baskets asynchronously in a separate
+    // thread.
+    // Asynchronous prefetching is a global setting of ROOT that applies to
+    // files opened after the construction of a TreeCache.
+    TreeCache(const long long cache_mb = -1, const int learn_entries = 0,
+              const bool prefetch = false);
+
+    // Add all active branches of the tree to the cache.
+    // Must be called after the branches have been set up for reading.
+    // Can be called again when more branches are activated.
+    void set_up(TTree *tree) const;
+
+    // Print the number of bytes and read calls of all input files and, if
+    // a tree is given, the efficiency of its cache.
+    void print_statistics(TTree *tree = nullptr) const;
+
+    long long cache_mb;
+    int learn_entries;
+    bool prefetch;
+};
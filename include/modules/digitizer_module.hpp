@@ -17,10 +17,7 @@
 
 #pragma once
 
-#include <random>
-
-using std::mt19937;
-using std::uniform_real_distribution;
+#include <cstdint>
 
 #include <string>
 
@@ -42,13 +39,15 @@ struct DigitizerModule : Module {
                     const bool add_pseudorandom_number_to_integers = false)
         : Module(address, add_pseudorandom_number_to_integers),
           reference_time(reference_time_branch_name),
-          timestamp(timestamp_branch_name), random_engine(0),
-          uniform_distribution(-0.5, 0.5) {}
+          timestamp(timestamp_branch_name) {}
 
     Branch<double, 1> reference_time;
     Branch<uint64_t, 1> timestamp;
-    mt19937 random_engine;
-    uniform_real_distribution<double> uniform_distribution;
+    // Set by set_up_raw_branches_for_reading(). Leaves that are filled by a
+    // TTree are written without being recorded, so modules that only reset
+    // the leaves which were written since the last reset have to reset all
+    // of them.
+    bool raw_leaves_read_from_tree = false;
 
     void process_data_word(const u_int32_t word) = 0;
     void reset_raw_leaves(const vector<bool> amp_t_tref_ts = {
@@ -77,7 +76,35 @@ struct DigitizerModule : Module {
     set_up_raw_reference_time_branches_for_writing(TTree *tree) = 0;
     virtual void set_up_raw_timestamp_branches_for_writing(TTree *tree) = 0;
 
-    double get_amplitude(const size_t leaf);
+    // Adds a pseudorandom number from [-0.5, 0.5) to an integer amplitude, if
+    // requested for this module.
+    // The number is a hash of the entry, the module address, and the leaf
+    // instead of the next number from a random number generator. This way, it
+    // does not depend on which entries were processed before, and the results
+    // are the same no matter how the entries are divided among threads or
+    // batches.
+    double dither(const double raw_amplitude, const long long n_entry,
+                  const size_t leaf) const {
+        if (add_pseudorandom_number_to_integers) {
+            return raw_amplitude + get_pseudorandom_number(n_entry, leaf);
+        }
+        return raw_amplitude;
+    }
+    double get_pseudorandom_number(const long long n_entry,
+                                   const size_t leaf) const {
+        const uint64_t hash = mix((uint64_t)n_entry) ^
+                              ((uint64_t)address << 32 | (uint64_t)leaf);
+        // The upper 53 bits are uniformly distributed in [0, 1).
+        return (mix(hash) >> 11) * 0x1.0p-53 - 0.5;
+    }
+    // Finalizer of the SplitMix64 generator.
+    static uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+    double get_amplitude(const size_t leaf, const long long n_entry);
     virtual double get_raw_amplitude(const size_t leaf) = 0;
     virtual double get_time(const size_t leaf) const = 0;
     double get_reference_time() const { return reference_time.leaves[0]; };
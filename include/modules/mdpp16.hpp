@@ -25,16 +25,25 @@ struct MDPP16 : public DigitizerModule {
     MDPP16(const unsigned int address, const string amplitude_branch_name,
            const string time_branch_name,
            const string reference_time_branch_name,
-           const string timestamp_branch_name)
+           const string timestamp_branch_name,
+           const u_int32_t n_channel_addresses)
         : DigitizerModule(address, reference_time_branch_name,
                           timestamp_branch_name, true),
-          amplitude(amplitude_branch_name), time(time_branch_name) {}
+          amplitude(amplitude_branch_name), time(time_branch_name),
+          n_channel_addresses(n_channel_addresses) {}
 
     Branch<double, 16> amplitude;
     Branch<double, 16> time;
 
     u_int32_t channel_address, data_word;
 
+    // Bit n_leaf is set if amplitude leaf n_leaf, and bit 16 + n_leaf if time
+    // leaf n_leaf was written since the last reset, so that the resets only
+    // touch those leaves.
+    // Initially, all bits are set, so that the first reset initializes all
+    // leaves.
+    uint32_t written_leaves = 0xFFFFFFFF;
+
     double get_raw_amplitude(const size_t leaf) override final {
         return amplitude.leaves[leaf];
     }
@@ -44,21 +53,30 @@ struct MDPP16 : public DigitizerModule {
 
     void set_amplitude(const size_t leaf, const double amp) override final {
         amplitude.leaves[leaf] = amp;
+        written_leaves |= uint32_t(1) << leaf;
     }
 
     void set_time(const size_t leaf, const double t) override final {
         time.leaves[leaf] = t;
+        written_leaves |= uint32_t(1) << (16 + leaf);
     }
 
     bool data_found(const u_int32_t word) override final;
     bool eoe_found(const u_int32_t word) override final;
     bool extended_ts_found(const u_int32_t word);
     u_int32_t get_data_length(const u_int32_t word) override final;
+    bool get_header_format(HeaderFormat &header_format) const override final;
     u_int32_t get_high_stamp(const u_int32_t word) override final;
     u_int32_t get_low_stamp(const u_int32_t word) override final;
     u_int32_t get_module_id(const u_int32_t word) override final;
+    // Keep DigitizerModule::get_timestamp() visible next to the overload.
+    using DigitizerModule::get_timestamp;
+    bool get_timestamp(const u_int32_t *words, const size_t n_words,
+                       u_int64_t &timestamp) override final;
     bool header_found(const u_int32_t word) override final;
     void process_data_word(const u_int32_t word) = 0;
+    bool process_event(const u_int32_t *words,
+                       const size_t n_words) override final;
     void process_high_stamp(const uint32_t word) override final {
         timestamp.leaves[0] += ((u_int64_t) (word & high_stamp_mask)) * high_stamp_offset;
     };
@@ -82,21 +100,29 @@ struct MDPP16 : public DigitizerModule {
     set_up_raw_reference_time_branches_for_writing(TTree *tree) override final;
     void set_up_raw_timestamp_branches_for_writing(TTree *tree) override final;
 
-    const u_int32_t channel_address_mask = 0x003F0000;
-    const u_int32_t channel_address_offset = 0x0010000;
-    const u_int32_t data_found_flag = 0x10000000;
-    const u_int32_t data_found_mask = 0xF0000000;
-    const u_int32_t data_length_mask = 0x000003FF;
-    const u_int32_t data_mask = 0x0000FFFF;
-    const u_int32_t eoe_mask = 0xC0000000;
-    const u_int32_t eoe_found_flag = eoe_mask;
-    const u_int32_t extended_ts_flag = 0x04800000;
-    const u_int32_t extended_ts_mask = 0xFF800000;
-    const u_int32_t high_stamp_mask = 0x0000FFFF;
-    const u_int32_t high_stamp_offset = 0x40000000;
-    const u_int32_t header_mask = 0xC0000000;
-    const u_int32_t header_found_flag = 0x40000000;
-    const u_int32_t low_stamp_mask = 0x3FFFFFFF;
-    const u_int32_t module_id_mask = 0x00FF0000;
-    const u_int32_t module_id_offset = 0x10000;
+    static constexpr u_int32_t channel_address_mask = 0x003F0000;
+    static constexpr u_int32_t channel_address_offset = 0x0010000;
+    static constexpr u_int32_t data_found_flag = 0x10000000;
+    static constexpr u_int32_t data_found_mask = 0xF0000000;
+    static constexpr u_int32_t data_length_mask = 0x000003FF;
+    static constexpr u_int32_t data_mask = 0x0000FFFF;
+    static constexpr u_int32_t eoe_mask = 0xC0000000;
+    static constexpr u_int32_t eoe_found_flag = eoe_mask;
+    static constexpr u_int32_t extended_ts_flag = 0x04800000;
+    static constexpr u_int32_t extended_ts_mask = 0xFF800000;
+    static constexpr u_int32_t high_stamp_mask = 0x0000FFFF;
+    static constexpr u_int32_t high_stamp_offset = 0x40000000;
+    static constexpr u_int32_t header_mask = 0xC0000000;
+    static constexpr u_int32_t header_found_flag = 0x40000000;
+    static constexpr u_int32_t low_stamp_mask = 0x3FFFFFFF;
+    static constexpr u_int32_t module_id_mask = 0x00FF0000;
+    static constexpr u_int32_t module_id_offset = 0x10000;
+
+    // Channel addresses 0-15 contain amplitudes, 16-31 times, and the
+    // addresses from 32 up to n_channel_addresses - 1 the reference time.
+    // Larger addresses are ignored.
+    const u_int32_t n_channel_addresses;
+
+    // Number of words that are classified at once by process_event().
+    static constexpr size_t batch_size = 16;
 };
\ No newline at end of file
@@ -17,6 +17,10 @@
 
 #pragma once
 
+#include <memory>
+
+using std::make_shared;
+
 #include "mdpp16.hpp"
 
 struct MDPP16_SCP : public MDPP16 {
@@ -25,7 +29,10 @@ struct MDPP16_SCP : public MDPP16 {
                const string reference_time_branch_name,
                const string timestamp_branch_name)
         : MDPP16(address, amplitude_branch_name, time_branch_name,
-                 reference_time_branch_name, timestamp_branch_name) {}
+                 reference_time_branch_name, timestamp_branch_name, 64) {}
 
+    shared_ptr<Module> clone() const override final {
+        return make_shared<MDPP16_SCP>(*this);
+    }
     void process_data_word(const u_int32_t word);
 };
\ No newline at end of file
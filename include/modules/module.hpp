@@ -17,8 +17,35 @@
 
 #pragma once
 
+#include <memory>
+
+using std::shared_ptr;
+
 #include "TTree.h"
 
+// Bit pattern that identifies a module header in a listfile, and the position
+// of the module ID in the header word.
+// The module ID is (word & module_id_mask) / module_id_offset and must fit
+// into 8 bits.
+struct HeaderFormat {
+    u_int32_t header_mask;
+    u_int32_t header_found_flag;
+    u_int32_t module_id_mask;
+    u_int32_t module_id_offset;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(header_mask, header_found_flag, module_id_mask,
+                module_id_offset);
+    }
+
+    bool operator==(const HeaderFormat &header_format) const {
+        return header_mask == header_format.header_mask &&
+               header_found_flag == header_format.header_found_flag &&
+               module_id_mask == header_format.module_id_mask &&
+               module_id_offset == header_format.module_id_offset;
+    }
+};
+
 struct Module {
     Module(const unsigned int address,
            const bool add_pseudorandom_number_to_integers = false)
@@ -26,15 +53,42 @@ struct Module {
                                 add_pseudorandom_number_to_integers) {}
     const unsigned int address;
     const bool add_pseudorandom_number_to_integers;
+    virtual shared_ptr<Module> clone() const = 0;
     virtual bool data_found(const u_int32_t word) = 0;
     virtual bool eoe_found(const u_int32_t word) = 0;
     virtual bool extended_ts_found(const u_int32_t word) = 0;
     virtual u_int32_t get_data_length(const u_int32_t word) = 0;
+    // Returns false if the module does not write headers to the listfile.
+    virtual bool get_header_format(HeaderFormat &header_format) const = 0;
     virtual u_int32_t get_high_stamp(const u_int32_t word) = 0;
     virtual u_int32_t get_low_stamp(const u_int32_t word) = 0;
     virtual u_int32_t get_module_id(const u_int32_t word) = 0;
+    // Extract the timestamp from the n_words words that follow a module
+    // header in a listfile without processing them.
+    // Returns false if the words contain no timestamp.
+    virtual bool get_timestamp([[maybe_unused]] const u_int32_t *words,
+                               [[maybe_unused]] const size_t n_words,
+                               [[maybe_unused]] u_int64_t &timestamp) {
+        return false;
+    }
     virtual bool header_found(const u_int32_t word) = 0;
     virtual void process_data_word(const uint32_t word) = 0;
+    // Process the n_words words that follow a module header in a listfile.
+    // Returns true if an end-of-event word was found.
+    virtual bool process_event(const u_int32_t *words, const size_t n_words) {
+        bool end_of_event = false;
+        for (size_t n_word = 0; n_word < n_words; ++n_word) {
+            if (data_found(words[n_word])) {
+                process_data_word(words[n_word]);
+            } else if (extended_ts_found(words[n_word])) {
+                process_high_stamp(words[n_word]);
+            } else if (eoe_found(words[n_word])) {
+                process_low_stamp(words[n_word]);
+                end_of_event = true;
+            }
+        }
+        return end_of_event;
+    }
     virtual void process_high_stamp(const uint32_t word) = 0;
     virtual void process_low_stamp(const uint32_t word) = 0;
     virtual void reset_raw_leaves(const vector<bool> flags) = 0;
@@ -17,6 +17,10 @@
 
 #pragma once
 
+#include <memory>
+
+using std::make_shared;
+
 #include "TTree.h"
 
 #include "digitizer_module.hpp"
@@ -47,13 +51,36 @@ struct SIS3316 final : public DigitizerModule {
         time.leaves[leaf] = t;
     }
 
+    shared_ptr<Module> clone() const override final {
+        return make_shared<SIS3316>(*this);
+    }
+
     bool data_found([[maybe_unused]] const u_int32_t word) override final {
         return false;
     }
+    bool eoe_found([[maybe_unused]] const u_int32_t word) override final {
+        return false;
+    }
+    bool extended_ts_found([
+        [maybe_unused]] const u_int32_t word) override final {
+        return false;
+    }
     u_int32_t get_data_length([
         [maybe_unused]] const u_int32_t word) override final {
         return 0;
     };
+    bool get_header_format([
+        [maybe_unused]] HeaderFormat &header_format) const override final {
+        return false;
+    };
+    u_int32_t get_high_stamp([
+        [maybe_unused]] const u_int32_t word) override final {
+        return 0;
+    };
+    u_int32_t get_low_stamp([
+        [maybe_unused]] const u_int32_t word) override final {
+        return 0;
+    };
     u_int32_t get_module_id([
         [maybe_unused]] const u_int32_t word) override final {
         return 0;
@@ -63,6 +90,10 @@ struct SIS3316 final : public DigitizerModule {
     };
     void process_data_word([
         [maybe_unused]] const u_int32_t word) override final{};
+    void process_high_stamp([
+        [maybe_unused]] const u_int32_t word) override final{};
+    void process_low_stamp([
+        [maybe_unused]] const u_int32_t word) override final{};
     void reset_raw_amplitude_leaves() override final;
     void reset_raw_time_leaves() override final;
     void reset_raw_reference_time_leaves() override final;
@@ -17,6 +17,10 @@
 
 #pragma once
 
+#include <memory>
+
+using std::make_shared;
+
 #include "branch.hpp"
 #include "scaler_module.hpp"
 
@@ -40,13 +44,36 @@ struct V830 final : public ScalerModule {
         counter_values.leaves[leaf] += (double)counts;
     }
 
+    shared_ptr<Module> clone() const override final {
+        return make_shared<V830>(*this);
+    }
+
     bool data_found([[maybe_unused]] const u_int32_t word) override final {
         return false;
     }
+    bool eoe_found([[maybe_unused]] const u_int32_t word) override final {
+        return false;
+    }
+    bool extended_ts_found([
+        [maybe_unused]] const u_int32_t word) override final {
+        return false;
+    }
     u_int32_t get_data_length([
         [maybe_unused]] const u_int32_t word) override final {
         return 0;
     };
+    bool get_header_format([
+        [maybe_unused]] HeaderFormat &header_format) const override final {
+        return false;
+    };
+    u_int32_t get_high_stamp([
+        [maybe_unused]] const u_int32_t word) override final {
+        return 0;
+    };
+    u_int32_t get_low_stamp([
+        [maybe_unused]] const u_int32_t word) override final {
+        return 0;
+    };
     u_int32_t get_module_id([
         [maybe_unused]] const u_int32_t word) override final {
         return 0;
@@ -56,6 +83,10 @@ struct V830 final : public ScalerModule {
     };
     void process_data_word([
         [maybe_unused]] const u_int32_t word) override final{};
+    void process_high_stamp([
+        [maybe_unused]] const u_int32_t word) override final{};
+    void process_low_stamp([
+        [maybe_unused]] const u_int32_t word) override final{};
     void reset_raw_counter_leaves() override final;
     void set_up_raw_counter_branches_for_reading(TTree *tree) override final;
     void set_up_raw_counter_branches_for_writing(TTree *tree) override final;
@@ -0,0 +1,159 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <unistd.h>
+
+#include <cstdint>
+
+#include <cstdio>
+
+using std::remove;
+using std::rename;
+
+#include <cstring>
+
+using std::memcmp;
+
+#include <string>
+
+using std::string;
+using std::to_string;
+
+#include <vector>
+
+using std::vector;
+
+#include "binary_archive.hpp"
+#include "module.hpp"
+
+// Positions of the module headers in a listfile.
+//
+// A listfile can only be decoded sequentially, because data words may look
+// like module headers. Whether a word is a header is only known after the
+// data words of the preceding module have been skipped.
+// The 'mvlclst' reader treats each module frame, i.e. a module header and its
+// data words, as one entry, like an entry of a TTree.
+// The index stores the total number of entries and the word index of the
+// header of every frame_stride-th entry, as found by a sequential read with
+// the given header formats and the types of the modules with each ID, which
+// determine the frames that are found. A reader can jump to the indexed header before any
+// entry, and skip at most frame_stride - 1 entries from there, instead of
+// reading the file from the beginning.
+//
+// The index is stored in a sidecar file, which is only valid for the size and
+// modification time of the listfile at the time the index was created.
+struct ListfileIndex {
+    uint64_t frame_stride = 0;
+    vector<HeaderFormat> header_formats;
+    // For each header format, the type name of the module with each ID, or an
+    // empty string if the ID belongs to no module.
+    vector<vector<string>> module_types;
+    int64_t n_frames = 0;
+    vector<int64_t> frame_headers;
+
+    template <class Archive> void serialize(Archive &archive) {
+        archive(frame_stride, header_formats, module_types, n_frames,
+                frame_headers);
+    }
+
+    // Returns false if the index file does not exist, is corrupted, or
+    // belongs to a different version of the listfile.
+    bool read(const string &index_file_name, const string &listfile_name);
+    // The index is written to a temporary file first, which is then renamed,
+    // so that processes that read the same listfile in parallel never see an
+    // incomplete index.
+    void write(const string &index_file_name, const string &listfile_name);
+
+    // Returns the last indexed entry at or before 'entry', and the word
+    // index of its header.
+    long long find_frame(const long long entry, long long &header) const {
+        const size_t n_header = entry / frame_stride;
+        header = frame_headers[n_header];
+        return n_header * frame_stride;
+    }
+
+    // Increase the version if the layout of the index changes.
+    static constexpr char magic[8] = {'c', 'a', 'r', 'o', 'i', 'd', 'x', '\0'};
+    static constexpr uint32_t version = 3;
+};
+
+inline bool ListfileIndex::read(const string &index_file_name,
+                                const string &listfile_name) {
+    int64_t size, modification_time;
+    if (!get_file_version(listfile_name, size, modification_time)) {
+        return false;
+    }
+    ifstream file(index_file_name, ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    char file_magic[sizeof(magic)];
+    file.read(file_magic, sizeof(file_magic));
+    uint32_t file_version = 0;
+    int64_t indexed_size = -1, indexed_modification_time = -1;
+    BinaryReader reader(file);
+    reader(file_version, indexed_size, indexed_modification_time);
+    if (!file.good() || memcmp(file_magic, magic, sizeof(magic)) ||
+        file_version != version || indexed_size != size ||
+        indexed_modification_time != modification_time) {
+        return false;
+    }
+
+    ListfileIndex index;
+    index.serialize(reader);
+    if (!file.good() || index.frame_stride == 0 || index.n_frames < 0 ||
+        index.frame_headers.size() !=
+            (index.n_frames + index.frame_stride - 1) / index.frame_stride) {
+        return false;
+    }
+    *this = index;
+    return true;
+}
+
+inline void ListfileIndex::write(const string &index_file_name,
+                                 const string &listfile_name) {
+    int64_t size, modification_time;
+    if (!get_file_version(listfile_name, size, modification_time)) {
+        return;
+    }
+    // Like the cache of the experiment configuration, the index is only an
+    // optimization, so a file that cannot be written is silently skipped.
+    const string temporary_file_name =
+        index_file_name + "." + to_string(getpid()) + ".tmp";
+    {
+        ofstream file(temporary_file_name, ios::binary);
+        if (!file.is_open()) {
+            return;
+        }
+        file.write(magic, sizeof(magic));
+        BinaryWriter writer(file);
+        uint32_t file_version = version;
+        writer(file_version, size, modification_time);
+        serialize(writer);
+        if (!file.good()) {
+            file.close();
+            remove(temporary_file_name.c_str());
+            return;
+        }
+    }
+    if (rename(temporary_file_name.c_str(), index_file_name.c_str())) {
+        remove(temporary_file_name.c_str());
+    }
+}
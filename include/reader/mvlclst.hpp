@@ -17,25 +17,60 @@
 
 #pragma once
 
-#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-using std::ifstream;
+#include <algorithm>
+
+using std::min;
+
+#include <array>
+
+using std::array;
 
 #include <iostream>
 
 using std::cout;
 using std::endl;
 
+#include <limits>
+
+using std::numeric_limits;
+
+#include <memory>
+
+using std::make_unique;
+using std::unique_ptr;
+
+#include <mutex>
+
+using std::lock_guard;
+using std::mutex;
+
+#include <typeinfo>
+
+#include "event_builder.hpp"
+#include "listfile_index.hpp"
 #include "reader.hpp"
 
+// Maps the module ID in a header word of a given format to the index of the
+// module in Analysis::modules.
+struct ModuleDispatchTable {
+    HeaderFormat header_format;
+    array<size_t, 256> module_index;
+
+    static constexpr size_t no_module = numeric_limits<size_t>::max();
+};
+
 struct Reader : ReaderBase {
     Reader(const vector<string> input_files, const long long first,
-           const long long last = -1)
-        : ReaderBase(input_files, first, last){};
+           const long long last = -1, const string mode = "entry")
+        : ReaderBase(input_files, first, last, mode){};
 
     void
-    initialize([[maybe_unused]] Analysis &analysis,
-               [[maybe_unused]] const string option,
+    initialize(Analysis &analysis, [[maybe_unused]] const string option,
                [[maybe_unused]] const vector<bool> counter_values = {false},
                [[maybe_unused]] const vector<bool> amp_t_tref_ts = {
                    false, false, false, false}) override final {
@@ -51,50 +86,215 @@ struct Reader : ReaderBase {
                     "arguments."
                  << endl;
         }
-        file.open(input_files[0], std::ios::binary | std::ios::ate);
-        n_words = file.tellg() / 4;
+        if (mode != "entry") {
+            cout << "Warning: reader mode '" << mode
+                 << "' was ignored. The 'mvlclst' reader always reads the "
+                    "file sequentially."
+                 << endl;
+        }
+        file_descriptor = open(input_files[0].c_str(), O_RDONLY);
+        if (file_descriptor == -1) {
+            cout << "Error: could not open file '" << input_files[0] << "'."
+                 << endl;
+            abort();
+        }
+        struct stat file_status;
+        if (fstat(file_descriptor, &file_status) == -1) {
+            cout << "Error: could not determine the size of file '"
+                 << input_files[0] << "'." << endl;
+            abort();
+        }
+        file_size = file_status.st_size;
+        n_words = file_size / sizeof(uint32_t);
 
-        last = (last == -1) ? n_words - 1 : last;
+        // The file is mapped as a whole and read sequentially, which allows
+        // the kernel to read ahead aggressively and avoids copying the data
+        // into a user-space buffer.
+        words = nullptr;
+        if (file_size > 0) {
+            void *mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE,
+                                 file_descriptor, 0);
+            if (mapping == MAP_FAILED) {
+                cout << "Error: could not map file '" << input_files[0]
+                     << "' into memory." << endl;
+                abort();
+            }
+            madvise(mapping, file_size, MADV_SEQUENTIAL);
+            words = static_cast<const uint32_t *>(mapping);
+        }
 
-        file.seekg(std::ios::beg);
+        build_module_dispatch_tables(analysis);
+        load_or_build_index(analysis);
+        n_entries = index.n_frames;
+        last = (last == -1 || last >= n_entries) ? n_entries - 1 : last;
+        // The entries are module frames, not events. An event that crosses
+        // the boundary of a range would be split.
+        if (event_window >= 0 && (first > 0 || last < n_entries - 1)) {
+            cout << "Error: option '--event-window' can only be used to read "
+                    "the whole file, because the entries of the 'mvlclst' "
+                    "reader are module frames, not events. Aborting ..."
+                 << endl;
+            abort();
+        }
+        seek(first, analysis);
+        first_word = word + 1;
+        n_unknown_module_headers = 0;
+
+        event_builder.reset();
+        if (event_window >= 0) {
+            event_builder = make_unique<EventBuilder>(
+                analysis.modules.size(), event_window, event_buffer_capacity);
+            last_timestamps.assign(analysis.modules.size(), 0);
+            n_events = 0;
+            n_frames = 0;
+        }
     };
 
-    bool read(unsigned int &status, Analysis &analysis) override final {
-        entry = file.tellg() / 4;
-        status = 0;
-        while (file.read(reinterpret_cast<char *>(&data_integer),
-                         sizeof(data_integer)) &&
-               entry < last) {
-            for (auto module : analysis.modules) {
-                if (module->header_found(data_integer)) {
-                    module_id = module->get_module_id(data_integer);
-                    if (analysis.find_module_by_id(module_index, module_id)) {
-                        data_length =
-                            analysis.modules[module_index]->get_data_length(
-                                data_integer);
-                        for (u_int32_t n_data_word = 0;
-                             n_data_word < data_length; ++n_data_word) {
-                            if (file.read(
-                                    reinterpret_cast<char *>(&data_integer),
-                                    sizeof(data_integer)) &&
-                                analysis.modules[module_index]->data_found(
-                                    data_integer)) {
-                                analysis.modules[module_index]
-                                    ->process_data_word(data_integer);
-                            }
-                            else if (analysis.modules[module_index]->extended_ts_found(
-                                    data_integer)) {
-                                analysis.modules[module_index]
-                                    ->process_high_stamp(data_integer);
-                            }
-                            else if (analysis.modules[module_index]->eoe_found(
-                                    data_integer)) {
-                                analysis.modules[module_index]
-                                    ->process_low_stamp(data_integer);
-                                status = 1;
-                            }
-                        }
+    // Create one table for each distinct header format in the analysis.
+    // If several modules have the same ID, the first one is used, like in
+    // Analysis::find_module_by_id().
+    void build_module_dispatch_tables(const Analysis &analysis) {
+        module_dispatch_tables.clear();
+        HeaderFormat header_format;
+        for (auto module : analysis.modules) {
+            if (!module->get_header_format(header_format)) {
+                continue;
+            }
+            if (header_format.module_id_mask / header_format.module_id_offset >
+                0xFF) {
+                cout << "Error: module IDs with more than 8 bits are not "
+                        "supported by the 'mvlclst' reader."
+                     << endl;
+                abort();
+            }
+            bool header_format_known = false;
+            for (auto &table : module_dispatch_tables) {
+                if (table.header_format == header_format) {
+                    header_format_known = true;
+                }
+            }
+            if (header_format_known) {
+                continue;
+            }
+
+            ModuleDispatchTable table;
+            table.header_format = header_format;
+            table.module_index.fill(ModuleDispatchTable::no_module);
+            for (size_t n_module = 0; n_module < analysis.modules.size();
+                 ++n_module) {
+                const unsigned int address = analysis.modules[n_module]->address;
+                if (address < table.module_index.size() &&
+                    table.module_index[address] ==
+                        ModuleDispatchTable::no_module) {
+                    table.module_index[address] = n_module;
+                }
+            }
+            module_dispatch_tables.push_back(table);
+        }
+    }
+
+    // Read the index from the file '<input file>.idx', or create it with a
+    // sequential pass over the file if it does not exist or is out of date.
+    // Readers of the same file in other threads wait until the index is
+    // available.
+    void load_or_build_index(Analysis &analysis) {
+        static mutex index_mutex;
+        lock_guard<mutex> lock(index_mutex);
+
+        const string index_file_name = input_files[0] + ".idx";
+        vector<HeaderFormat> header_formats;
+        vector<vector<string>> module_types;
+        for (const auto &table : module_dispatch_tables) {
+            header_formats.push_back(table.header_format);
+            module_types.emplace_back(table.module_index.size());
+            for (size_t module_id = 0; module_id < table.module_index.size();
+                 ++module_id) {
+                if (table.module_index[module_id] !=
+                    ModuleDispatchTable::no_module) {
+                    const Module &module =
+                        *analysis.modules[table.module_index[module_id]];
+                    module_types.back()[module_id] = typeid(module).name();
+                }
+            }
+        }
+        if (index.read(index_file_name, input_files[0]) &&
+            index.frame_stride == index_frame_stride &&
+            index.header_formats == header_formats &&
+            index.module_types == module_types) {
+            return;
+        }
+
+        cout << "Creating index '" << index_file_name << "' ..." << endl;
+        index = ListfileIndex();
+        index.frame_stride = index_frame_stride;
+        index.header_formats = header_formats;
+        index.module_types = module_types;
+        const long long previous_last = last;
+        word = -1;
+        entry = -1;
+        last = numeric_limits<long long>::max();
+        while (next_frame(frame, analysis)) {
+            if (entry % index_frame_stride == 0) {
+                index.frame_headers.push_back(frame.words - words - 1);
+            }
+        }
+        index.n_frames = entry + 1;
+        last = previous_last;
+        index.write(index_file_name, input_files[0]);
+    }
+
+    // Continue reading at entry 'new_entry'.
+    // The entries between the last indexed one and 'new_entry' are skipped
+    // like in a sequential read, so the result is the same as if the file had
+    // been read from the beginning.
+    void seek(const long long new_entry, Analysis &analysis) {
+        if (new_entry <= 0 || new_entry >= n_entries) {
+            word = new_entry <= 0 ? -1 : n_words - 1;
+            entry = new_entry - 1;
+            return;
+        }
+        long long header;
+        entry = index.find_frame(new_entry, header) - 1;
+        word = header - 1;
+        const long long previous_last = last;
+        last = new_entry - 1;
+        while (next_frame(frame, analysis)) {
+        }
+        last = previous_last;
+    }
+
+    // Find the next module header of a known module, and store the data words
+    // that follow it in 'frame'.
+    // A header with a module ID that does not belong to any module of the
+    // analysis is counted and skipped. Its data words are scanned for the next
+    // header, since their number is only known for modules of the analysis.
+    // Each frame is one entry, so consecutive ranges of entries can be read
+    // independently without processing any module data twice.
+    bool next_frame(ModuleFrame &frame, Analysis &analysis) {
+        if (entry >= last) {
+            return false;
+        }
+        while (read_word()) {
+            for (const auto &table : module_dispatch_tables) {
+                if ((data_integer & table.header_format.header_mask) ==
+                    table.header_format.header_found_flag) {
+                    module_id = (data_integer &
+                                 table.header_format.module_id_mask) /
+                                table.header_format.module_id_offset;
+                    module_index = table.module_index[module_id];
+                    if (module_index == ModuleDispatchTable::no_module) {
+                        ++n_unknown_module_headers;
+                        break;
                     }
+                    data_length =
+                        min((long long)analysis.modules[module_index]
+                                ->get_data_length(data_integer),
+                            n_words - word - 1);
+                    frame.words = words + word + 1;
+                    frame.n_words = data_length;
+                    frame.module = module_index;
+                    word += data_length;
+                    ++entry;
                     return true;
                 }
             }
@@ -102,11 +302,123 @@ struct Reader : ReaderBase {
         return false;
     }
 
-    void finalize() override final { file.close(); }
+    // Without an event window, each entry is processed as an event.
+    // Otherwise, the data of all modules whose timestamps lie inside the
+    // window are processed before returning, ordered by timestamp.
+    // In this case, 'entry' is the last module frame that was read ahead.
+    bool read(unsigned int &status, Analysis &analysis) override final {
+        status = 0;
+        if (!event_builder) {
+            if (!next_frame(frame, analysis)) {
+                return false;
+            }
+            if (analysis.modules[frame.module]->process_event(frame.words,
+                                                              frame.n_words)) {
+                status = 1;
+            }
+            return true;
+        }
 
-    bool module_found;
-    ifstream file;
-    long long n_words;
-    uint32_t channel_number, data_integer, data_length, module_id;
+        while (!event_builder->is_ready() && next_frame(frame, analysis)) {
+            // Modules without a timestamp in the data keep the last one, so
+            // that their frames stay ordered.
+            if (analysis.modules[frame.module]->get_timestamp(
+                    frame.words, frame.n_words, frame.timestamp)) {
+                last_timestamps[frame.module] = frame.timestamp;
+            } else {
+                frame.timestamp = last_timestamps[frame.module];
+            }
+            event_builder->push(frame);
+            ++n_frames;
+        }
+        if (event_builder->empty()) {
+            return false;
+        }
+        event_builder->build_event(event);
+        ++n_events;
+        for (const auto &module_frame : event) {
+            // The timestamp is accumulated by process_event().
+            analysis.modules[module_frame.module]->reset_raw_leaves(
+                {false, false, false, true});
+            if (analysis.modules[module_frame.module]->process_event(
+                    module_frame.words, module_frame.n_words)) {
+                status = 1;
+            }
+        }
+        return true;
+    }
+
+    void set_up_calibrated_branches_for_reading([
+        [maybe_unused]] Analysis &analysis) override final {
+        cout << "Error: The 'mvlclst' reader can only provide raw data." << endl;
+        abort();
+    }
+
+    // The name of the tree that 'mvlclst_to_root' creates.
+    string get_tree_name() const override final { return "events"; }
+
+    void print_statistics() const override final {
+        cout << "Read " << (word - first_word + 1) * sizeof(uint32_t) << " of "
+             << file_size << " bytes from '" << input_files[0]
+             << "' through a memory mapping." << endl;
+        if (n_unknown_module_headers > 0) {
+            cout << "Warning: skipped " << n_unknown_module_headers
+                 << " module headers with IDs that do not belong to any "
+                    "module of the analysis."
+                 << endl;
+        }
+        if (event_builder) {
+            cout << "Built " << n_events << " events from " << n_frames
+                 << " module frames with a window of " << event_window
+                 << " clock ticks." << endl;
+            if (event_builder->get_n_late_frames() > 0) {
+                cout << "Warning: " << event_builder->get_n_late_frames()
+                     << " module frames arrived after their event had been "
+                        "built, because the readout of their module lagged "
+                        "behind by more than "
+                     << event_buffer_capacity << " frames." << endl;
+            }
+        }
+    }
+
+    void finalize() override final {
+        if (words != nullptr) {
+            munmap(const_cast<uint32_t *>(words), file_size);
+            words = nullptr;
+        }
+        close(file_descriptor);
+    }
+
+    bool read_word() {
+        if (word + 1 < n_words) {
+            data_integer = words[++word];
+            return true;
+        }
+        return false;
+    }
+
+    int file_descriptor;
+    size_t file_size;
+    const uint32_t *words;
+    vector<ModuleDispatchTable> module_dispatch_tables;
+    // Index of the last word that was read, and of the first word of the
+    // range.
+    long long n_words, word, first_word;
+    long long n_entries;
+    long long n_unknown_module_headers;
+    uint32_t data_integer, data_length, module_id;
     size_t module_index;
+
+    // Number of entries between two indexed module headers.
+    static constexpr long long index_frame_stride = 1024;
+    ListfileIndex index;
+
+    // Maximum number of frames per module that wait for the frames of the
+    // other modules.
+    static constexpr size_t event_buffer_capacity = 1024;
+    unique_ptr<EventBuilder> event_builder;
+    ModuleFrame frame;
+    vector<ModuleFrame> event;
+    vector<uint64_t> last_timestamps;
+    long long n_events, n_frames;
 };
\ No newline at end of file
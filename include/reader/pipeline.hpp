@@ -0,0 +1,67 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+
+#include <functional>
+
+using std::function;
+
+#include "analysis.hpp"
+#include "calibration_batch.hpp"
+#include "progress_printer.hpp"
+#include "reader.hpp"
+
+// Processes the entries of a reader in three stages that run in separate
+// threads and pass batches of events to each other:
+//  1. read:      the calling thread reads the entries with ReaderBase::read()
+//                and copies the raw data of each event into a batch with
+//                Analysis::add_to_batch().
+//  2. calibrate: applies 'calibrate' to each batch, e.g.
+//                Analysis::calibrate_batch().
+//  3. fill:      applies 'fill' to each batch, e.g. loads the events with
+//                Analysis::load_from_batch() and fills histograms.
+// This way, waiting for the input overlaps with the calibration and the
+// filling of the previous batches.
+//
+// A fixed number of batches circulates between the stages through
+// single-producer/single-consumer queues, i.e. a stage that is faster than
+// the next one has to wait for a free batch. Each stage processes the batches
+// in the order in which they were read, which is required by the count rates
+// of the calibration.
+// The stages must not share any state, so 'calibrate' and 'fill' should work
+// on their own clones of the analysis.
+class Pipeline {
+  public:
+    Pipeline(const size_t batch_size, const size_t n_batches = 4);
+
+    void run(ReaderBase &reader, Analysis &analysis,
+             const function<void(CalibrationBatch &)> &calibrate,
+             const function<void(CalibrationBatch &)> &fill,
+             ProgressPrinter *progress_printer = nullptr);
+    void print_statistics() const;
+
+    const size_t batch_size, n_batches;
+
+  private:
+    long long n_events, n_batches_read;
+    // Time in seconds that the stages spent waiting for a free batch (read)
+    // or for the next batch (calibrate and fill).
+    double read_waiting_time, calibrate_waiting_time, fill_waiting_time;
+};
@@ -27,19 +27,32 @@ using std::vector;
 
 #include "analysis.hpp"
 #include "tfile_utilities.hpp"
+#include "tree_cache.hpp"
 
 struct ReaderBase {
     ReaderBase(const vector<string> input_files, const long long first = 0,
-               const long long last = -1)
-        : input_files(input_files), first(first), last(last){};
+               const long long last = -1, const string mode = "entry")
+        : input_files(input_files), first(first), last(last), mode(mode){};
     virtual void initialize(Analysis &analysis, const string option,
                             const vector<bool> counter_values = {false},
                             const vector<bool> amp_t_tref_ts = {
                                 false, false, false, false}) = 0;
     virtual bool read(unsigned int &status, Analysis &analysis) = 0;
+    virtual void set_up_calibrated_branches_for_reading(Analysis &analysis) = 0;
+    // Name of the tree that contains the events, which is also used for
+    // output trees.
+    virtual string get_tree_name() const = 0;
+    // Print statistics about the input, e.g. the number of read calls.
+    virtual void print_statistics() const = 0;
     virtual void finalize() = 0;
 
     vector<string> input_files;
     long long entry;
     long long first, last;
+    string mode;
+    TreeCache tree_cache;
+    // Maximum timestamp difference of the module data that are merged into
+    // one event. Negative values disable the merging. Only used by readers of
+    // listfiles.
+    long long event_window = -1;
 };
\ No newline at end of file
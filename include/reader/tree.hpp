@@ -22,19 +22,31 @@
 using std::cout;
 using std::endl;
 
+#include <memory>
+
+using std::make_unique;
+using std::unique_ptr;
+
 #include "TChain.h"
 
+#include "bulk_tree_reader.hpp"
 #include "reader.hpp"
 
 struct Reader : ReaderBase {
     Reader(const vector<string> input_files, const long long first,
-           const long long last = -1)
-        : ReaderBase(input_files, first, last){};
+           const long long last = -1, const string mode = "entry")
+        : ReaderBase(input_files, first, last, mode){};
 
     void initialize(Analysis &analysis, const string tree_name,
                     const vector<bool> counter_values = {false},
                     const vector<bool> amp_t_tref_ts = {false, false, false,
                                                         false}) override final {
+        if (event_window >= 0) {
+            cout << "Warning: option '--event-window' was ignored. The 'tree' "
+                    "reader reads events that were already built."
+                 << endl;
+            event_window = -1;
+        }
         tree = new TChain(find_tree_in_file(input_files[0], tree_name).c_str());
         for (auto input_file : input_files) {
             cout << "Adding '" << input_file.c_str() << "' to TChain." << endl;
@@ -54,19 +66,43 @@ struct Reader : ReaderBase {
             tree, counter_values);
         analysis.set_up_raw_energy_sensitive_detector_branches_for_reading(
             tree, amp_t_tref_ts);
+        tree_cache.set_up(tree);
+
+        tree_reader = make_unique<BulkTreeReader>(tree, mode == "bulk");
     };
 
     bool read(unsigned int &status, [[maybe_unused]] Analysis &analysis) override final {
         ++entry;
         if (entry <= last) {
-            tree->GetEntry(entry);
+            tree_reader->get_entry(entry);
+            status = 1;
             return true;
         }
         return false;
     };
 
-    void finalize() override final{};
+    void set_up_calibrated_branches_for_reading(
+        Analysis &analysis) override final {
+        analysis.set_up_calibrated_counter_detector_branches_for_reading(tree);
+        analysis
+            .set_up_calibrated_energy_sensitive_detector_branches_for_reading(
+                tree);
+        tree_cache.set_up(tree);
+    };
+
+    string get_tree_name() const override final { return tree->GetName(); };
+
+    void print_statistics() const override final {
+        tree_cache.print_statistics(tree);
+    };
+
+    void finalize() override final {
+        tree_reader.reset();
+        delete tree;
+        tree = nullptr;
+    };
 
     TChain *tree;
+    unique_ptr<BulkTreeReader> tree_reader;
     long long n_entries;
 };
\ No newline at end of file
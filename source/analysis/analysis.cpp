@@ -19,9 +19,14 @@
 
 using std::isnan;
 
+#include <limits>
+
+using std::numeric_limits;
+
 #include <memory>
 
 using std::dynamic_pointer_cast;
+using std::make_shared;
 
 #include "analysis.hpp"
 #include "counter_detector_channel.hpp"
@@ -82,6 +87,37 @@ Analysis::Analysis(vector<shared_ptr<Module>> modules,
             ++counter_detector_group_index;
         }
     }
+
+    calibrated_channels = make_shared<CalibratedChannelTable>(
+        get_n_energy_sensitive_detector_channels());
+    size_t n_channel_index{0};
+    for (auto detector : energy_sensitive_detectors) {
+        first_channel_index.push_back(n_channel_index);
+        for (auto &channel : detector->channels) {
+            channel.bind_calibrated_channel_table(calibrated_channels,
+                                                  n_channel_index);
+            channel_modules.push_back(
+                digitizer_modules[module_index[channel.module]]);
+            channel_leaves.push_back(channel.channel);
+            calibration_kernels.push_back(CalibrationKernel(channel));
+            channel_detector_index.push_back(first_channel_index.size() - 1);
+            ++n_channel_index;
+        }
+    }
+    hit_detectors.reserve(energy_sensitive_detectors.size());
+}
+
+Analysis Analysis::clone() const {
+    vector<shared_ptr<Module>> cloned_modules;
+    for (auto module : modules) {
+        cloned_modules.push_back(module->clone());
+    }
+    vector<shared_ptr<Detector>> cloned_detectors;
+    for (auto detector : detectors) {
+        cloned_detectors.push_back(detector->clone());
+    }
+    return Analysis(cloned_modules, detector_groups, cloned_detectors,
+                    coincidence_matrices);
 }
 
 bool Analysis::find_module_by_id(size_t &module_index,
@@ -95,6 +131,14 @@ bool Analysis::find_module_by_id(size_t &module_index,
     return false;
 }
 
+size_t Analysis::get_n_counter_detector_channels() const {
+    size_t n_counter_detector_channels = 0;
+    for (auto detector : counter_detectors) {
+        n_counter_detector_channels += detector->channels.size();
+    }
+    return n_counter_detector_channels;
+}
+
 size_t Analysis::get_n_energy_sensitive_detector_channels() const {
     size_t n_energy_sensitive_detector_channels = 0;
     for (auto detector : energy_sensitive_detectors) {
@@ -150,6 +194,7 @@ void Analysis::set_up_calibrated_energy_sensitive_detector_branches_for_reading(
     for (auto detector : energy_sensitive_detectors) {
         detector->set_up_calibrated_branches_for_reading(tree);
     }
+    calibrated_channels->untracked_writes = true;
 }
 
 void Analysis::set_up_calibrated_energy_sensitive_detector_branches_for_writing(
@@ -160,13 +205,15 @@ void Analysis::set_up_calibrated_energy_sensitive_detector_branches_for_writing(
 }
 
 double Analysis::get_amplitude(const size_t n_detector,
-                               const size_t n_channel) const {
+                               const size_t n_channel,
+                               const long long n_entry) const {
     return digitizer_modules[module_index[energy_sensitive_detectors[n_detector]
                                               ->channels[n_channel]
                                               .module]]
         ->get_amplitude(energy_sensitive_detectors[n_detector]
                             ->channels[n_channel]
-                            .channel);
+                            .channel,
+                        n_entry);
 }
 
 long long Analysis::get_counts(const size_t n_detector,
@@ -217,6 +264,7 @@ void Analysis::calibrate(const long long n_entry) {
             energy_sensitive_detectors[n_detector]->addback();
         }
     }
+    update_hits();
     for (size_t n_detector = 0; n_detector < counter_detectors.size();
          ++n_detector) {
         for (size_t n_channel = 0;
@@ -230,89 +278,401 @@ void Analysis::calibrate(const long long n_entry) {
 void Analysis::calibrate_counter_detector(const int n_entry,
                                           const size_t n_detector,
                                           const size_t n_channel) {
-    if (n_entry > 1 && !isnan(get_counts(n_detector, n_channel)) &&
-        get_counts(n_detector, n_channel) > 0 &&
-        get_counts(n_detector, n_channel) != counter_detectors[n_detector]
-                                                 ->channels[n_channel]
-                                                 .previous_counts) {
-        counter_detectors[n_detector]->channels[n_channel].count_rate =
-            (get_counts(n_detector, n_channel) - counter_detectors[n_detector]
-                                                     ->channels[n_channel]
-                                                     .previous_counts) *
-            scaler_modules[module_index[counter_detectors[n_detector]
-                                            ->channels[n_channel]
-                                            .module]]
-                ->trigger_frequency;
-        counter_detectors[n_detector]->channels[n_channel].previous_counts =
-            get_counts(n_detector, n_channel);
+    calibrate_counter_detector(n_entry, n_detector, n_channel,
+                               get_counts(n_detector, n_channel));
+}
+
+void Analysis::calibrate_counter_detector(const int n_entry,
+                                          const size_t n_detector,
+                                          const size_t n_channel,
+                                          const long long counts) {
+    CounterDetectorChannel &channel =
+        counter_detectors[n_detector]->channels[n_channel];
+    if (n_entry > 1 && counts > 0 && counts != channel.previous_counts) {
+        channel.count_rate =
+            (counts - channel.previous_counts) *
+            scaler_modules[module_index[channel.module]]->trigger_frequency;
+        channel.previous_counts = counts;
     } else {
-        counter_detectors[n_detector]
-            ->channels[n_channel]
-            .reset_calibrated_leaves();
+        channel.reset_calibrated_leaves();
     }
 }
 
 void Analysis::calibrate_energy_sensitive_detector(const int n_entry,
                                                    const size_t n_detector,
                                                    const size_t n_channel) {
-    bool reset = false;
-    if (!isnan(get_amplitude(n_detector, n_channel))) {
-        energy_sensitive_detectors[n_detector]
-            ->channels[n_channel]
-            .time_calibrated =
-            energy_sensitive_detectors[n_detector]
-                ->channels[n_channel]
-                .time_calibration(get_time(n_detector, n_channel),
-                                  energy_sensitive_detectors[n_detector]
-                                      ->channels[n_channel]
-                                      .energy_calibrated);
-        energy_sensitive_detectors[n_detector]
-            ->channels[n_channel]
-            .time_vs_reference_time_calibrated =
-            energy_sensitive_detectors[n_detector]
-                ->channels[n_channel]
-                .time_calibrated -
-            energy_sensitive_detectors[n_detector]
-                ->channels[n_channel]
-                .time_calibration(get_reference_time(n_detector, n_channel),
-                                  energy_sensitive_detectors[n_detector]
-                                      ->channels[n_channel]
-                                      .energy_calibrated);
-        if (energy_sensitive_detectors[n_detector]
-                ->channels[n_channel]
-                .time_vs_reference_time_gate(
-                    energy_sensitive_detectors[n_detector]
-                        ->channels[n_channel]
-                        .time_vs_reference_time_calibrated)) {
-
-            energy_sensitive_detectors[n_detector]
-                ->channels[n_channel]
-                .energy_calibrated =
-                energy_sensitive_detectors[n_detector]
-                    ->channels[n_channel]
-                    .energy_calibration(get_amplitude(n_detector, n_channel),
-                                        n_entry);
-        } else {
-            reset = true;
+    const size_t n_channel_index =
+        first_channel_index[n_detector] + n_channel;
+    const EnergySensitiveDetectorChannel &channel =
+        energy_sensitive_detectors[n_detector]->channels[n_channel];
+    const CalibrationKernel &kernel = calibration_kernels[n_channel_index];
+    DigitizerModule &module = *channel_modules[n_channel_index];
+    const size_t leaf = channel_leaves[n_channel_index];
+    CalibratedChannelTable &table = *calibrated_channels;
+
+    if (!isnan(module.get_raw_amplitude(leaf))) {
+        table.mark_written(n_channel_index);
+        table.time[n_channel_index] = kernel.calibrate_time(
+            channel, module.get_time(leaf), table.energy[n_channel_index]);
+        table.time_vs_reference_time[n_channel_index] =
+            table.time[n_channel_index] -
+            kernel.calibrate_time(channel, module.get_reference_time(),
+                                  table.energy[n_channel_index]);
+        if (kernel.time_vs_reference_time_gate(
+                channel, table.time_vs_reference_time[n_channel_index])) {
+            table.energy[n_channel_index] = kernel.calibrate_energy(
+                channel, module.get_amplitude(leaf, n_entry), n_entry);
+            table.timestamp[n_channel_index] =
+                module.get_timestamp() * INVERSE_VME_CLOCK_FREQUENCY;
+            table.set_valid(n_channel_index,
+                            !isnan(table.energy[n_channel_index]));
+            return;
         }
-        energy_sensitive_detectors[n_detector]
-            ->channels[n_channel]
-            .timestamp_calibrated =
-            get_timestamp(n_detector, n_channel) * INVERSE_VME_CLOCK_FREQUENCY;
-    } else {
-        reset = true;
     }
 
-    if (reset) {
-        energy_sensitive_detectors[n_detector]
-            ->channels[n_channel]
-            .reset_calibrated_leaves();
+    if (table.is_written(n_channel_index)) {
+        table.reset(n_channel_index);
+    }
+}
+
+void Analysis::add_to_batch(CalibrationBatch &batch,
+                            const long long n_entry) {
+    const size_t n_event = batch.n_events;
+    for (size_t n_channel_index = 0; n_channel_index < channel_modules.size();
+         ++n_channel_index) {
+        DigitizerModule &module = *channel_modules[n_channel_index];
+        const size_t n = batch.index(n_channel_index, n_event);
+        batch.amplitude[n] =
+            module.get_raw_amplitude(channel_leaves[n_channel_index]);
+        batch.time[n] = module.get_time(channel_leaves[n_channel_index]);
+    }
+    for (size_t n_module = 0; n_module < digitizer_modules.size();
+         ++n_module) {
+        const size_t n = batch.index(n_module, n_event);
+        batch.reference_time[n] =
+            digitizer_modules[n_module]->get_reference_time();
+        batch.timestamp[n] = digitizer_modules[n_module]->get_timestamp();
+    }
+    size_t n_channel_index{0};
+    for (size_t n_detector = 0; n_detector < counter_detectors.size();
+         ++n_detector) {
+        for (size_t n_channel = 0;
+             n_channel < counter_detectors[n_detector]->channels.size();
+             ++n_channel) {
+            batch.counts[batch.index(n_channel_index, n_event)] =
+                get_counts(n_detector, n_channel);
+            ++n_channel_index;
+        }
+    }
+    batch.entries[n_event] = n_entry;
+    ++batch.n_events;
+}
+
+void Analysis::load_raw_from_batch(const CalibrationBatch &batch,
+                                   const size_t n_event) {
+    for (size_t n_channel_index = 0; n_channel_index < channel_modules.size();
+         ++n_channel_index) {
+        DigitizerModule &module = *channel_modules[n_channel_index];
+        const size_t n = batch.index(n_channel_index, n_event);
+        if (!isnan(batch.amplitude[n])) {
+            module.set_amplitude(channel_leaves[n_channel_index],
+                                 batch.amplitude[n]);
+        }
+        if (!isnan(batch.time[n])) {
+            module.set_time(channel_leaves[n_channel_index], batch.time[n]);
+        }
+    }
+    for (size_t n_module = 0; n_module < digitizer_modules.size();
+         ++n_module) {
+        const size_t n = batch.index(n_module, n_event);
+        digitizer_modules[n_module]->set_reference_time(
+            batch.reference_time[n]);
+        digitizer_modules[n_module]->set_timestamp(batch.timestamp[n]);
+    }
+}
+
+// Column kernels for the batch calibration.
+// The number of polynomial parameters is a template parameter, so that the
+// polynomials are unrolled and the loops over the events can be vectorized.
+
+template <size_t n_parameters>
+void calibrate_times(const CalibrationKernel &kernel, const double *amplitude,
+                     const double *time, const double *reference_time,
+                     double *time_calibrated,
+                     double *time_vs_reference_time_calibrated,
+                     double *gate_passed, const size_t n_events) {
+    const bool open = kernel.gate.type == GateKernel::Type::open;
+    const double lower_limit = kernel.gate.lower_limit;
+    const double upper_limit = kernel.gate.upper_limit;
+    for (size_t n_event = 0; n_event < n_events; ++n_event) {
+        const double calibrated_time =
+            kernel.time.evaluate<n_parameters>(time[n_event]);
+        const double time_vs_reference_time =
+            calibrated_time -
+            kernel.time.evaluate<n_parameters>(reference_time[n_event]);
+        time_calibrated[n_event] = calibrated_time;
+        time_vs_reference_time_calibrated[n_event] = time_vs_reference_time;
+        gate_passed[n_event] =
+            ((amplitude[n_event] == amplitude[n_event]) &
+             (open | ((time_vs_reference_time > lower_limit) &
+                      (time_vs_reference_time < upper_limit))))
+                ? 1.
+                : 0.;
+    }
+}
+
+template <size_t n_parameters>
+void calibrate_energies(const CalibrationKernel &kernel,
+                        const double *amplitude, double *energy_calibrated,
+                        const size_t n_events) {
+    for (size_t n_event = 0; n_event < n_events; ++n_event) {
+        energy_calibrated[n_event] =
+            kernel.energy.evaluate<n_parameters>(amplitude[n_event]);
+    }
+}
+
+// Sets the values of all events that did not pass the gate to NaN.
+// Each array is processed in a separate loop, which is simple enough to be
+// vectorized.
+void invalidate_failed_events(const double *gate_passed, double *values,
+                              const size_t n_events) {
+    const double nan = numeric_limits<double>::quiet_NaN();
+    for (size_t n_event = 0; n_event < n_events; ++n_event) {
+        values[n_event] = gate_passed[n_event] != 0. ? values[n_event] : nan;
+    }
+}
+
+void Analysis::calibrate_batch(CalibrationBatch &batch) {
+    const size_t n_events = batch.n_events;
+    const double nan = numeric_limits<double>::quiet_NaN();
+
+    // Calibrate the times and apply the gates.
+    // The energy that is passed to custom time calibrations is NaN, which is
+    // the value that the calibrated energy has after a reset.
+    size_t n_channel_index{0};
+    for (const auto &detector : energy_sensitive_detectors) {
+        for (const auto &channel : detector->channels) {
+            const CalibrationKernel &kernel =
+                calibration_kernels[n_channel_index];
+            const size_t first = batch.index(n_channel_index, 0);
+            const double *amplitude = &batch.amplitude[first];
+            const double *time = &batch.time[first];
+            const double *reference_time = &batch.reference_time[batch.index(
+                module_index[channel.module], 0)];
+            double *time_calibrated = &batch.time_calibrated[first];
+            double *time_vs_reference_time_calibrated =
+                &batch.time_vs_reference_time_calibrated[first];
+            double *gate_passed = &batch.gate_passed[first];
+
+            if (kernel.gate.type != GateKernel::Type::custom) {
+                switch (kernel.time.n_parameters) {
+                case 1:
+                    calibrate_times<1>(kernel, amplitude, time, reference_time,
+                                       time_calibrated,
+                                       time_vs_reference_time_calibrated,
+                                       gate_passed, n_events);
+                    ++n_channel_index;
+                    continue;
+                case 2:
+                    calibrate_times<2>(kernel, amplitude, time, reference_time,
+                                       time_calibrated,
+                                       time_vs_reference_time_calibrated,
+                                       gate_passed, n_events);
+                    ++n_channel_index;
+                    continue;
+                case 3:
+                    calibrate_times<3>(kernel, amplitude, time, reference_time,
+                                       time_calibrated,
+                                       time_vs_reference_time_calibrated,
+                                       gate_passed, n_events);
+                    ++n_channel_index;
+                    continue;
+                case 4:
+                    calibrate_times<4>(kernel, amplitude, time, reference_time,
+                                       time_calibrated,
+                                       time_vs_reference_time_calibrated,
+                                       gate_passed, n_events);
+                    ++n_channel_index;
+                    continue;
+                }
+            }
+
+            for (size_t n_event = 0; n_event < n_events; ++n_event) {
+                gate_passed[n_event] = 0.;
+                if (isnan(amplitude[n_event])) {
+                    continue;
+                }
+                time_calibrated[n_event] = kernel.calibrate_time(
+                    channel, time[n_event], nan);
+                time_vs_reference_time_calibrated[n_event] =
+                    time_calibrated[n_event] -
+                    kernel.calibrate_time(channel, reference_time[n_event],
+                                          nan);
+                if (kernel.time_vs_reference_time_gate(
+                        channel, time_vs_reference_time_calibrated[n_event])) {
+                    gate_passed[n_event] = 1.;
+                }
+            }
+            ++n_channel_index;
+        }
+    }
+
+    // The pseudorandom numbers only depend on the entry, so they are the same
+    // as in calibrate().
+    for (n_channel_index = 0; n_channel_index < channel_modules.size();
+         ++n_channel_index) {
+        const DigitizerModule &module = *channel_modules[n_channel_index];
+        if (!module.add_pseudorandom_number_to_integers) {
+            continue;
+        }
+        const size_t leaf = channel_leaves[n_channel_index];
+        for (size_t n_event = 0; n_event < n_events; ++n_event) {
+            const size_t n = batch.index(n_channel_index, n_event);
+            if (batch.gate_passed[n] != 0.) {
+                batch.amplitude[n] = module.dither(
+                    batch.amplitude[n], batch.entries[n_event], leaf);
+            }
+        }
+    }
+
+    // Calibrate the energies and timestamps, and invalidate the events that
+    // did not pass the gate.
+    n_channel_index = 0;
+    for (const auto &detector : energy_sensitive_detectors) {
+        for (const auto &channel : detector->channels) {
+            const CalibrationKernel &kernel =
+                calibration_kernels[n_channel_index];
+            const size_t first = batch.index(n_channel_index, 0);
+            const double *amplitude = &batch.amplitude[first];
+            const double *timestamp =
+                &batch.timestamp[batch.index(module_index[channel.module], 0)];
+            const double *gate_passed = &batch.gate_passed[first];
+            double *energy_calibrated = &batch.energy_calibrated[first];
+            double *time_calibrated = &batch.time_calibrated[first];
+            double *time_vs_reference_time_calibrated =
+                &batch.time_vs_reference_time_calibrated[first];
+            double *timestamp_calibrated = &batch.timestamp_calibrated[first];
+
+            switch (kernel.energy.n_parameters) {
+            case 1:
+                calibrate_energies<1>(kernel, amplitude, energy_calibrated,
+                                      n_events);
+                break;
+            case 2:
+                calibrate_energies<2>(kernel, amplitude, energy_calibrated,
+                                      n_events);
+                break;
+            case 3:
+                calibrate_energies<3>(kernel, amplitude, energy_calibrated,
+                                      n_events);
+                break;
+            case 4:
+                calibrate_energies<4>(kernel, amplitude, energy_calibrated,
+                                      n_events);
+                break;
+            default:
+                for (size_t n_event = 0; n_event < n_events; ++n_event) {
+                    if (gate_passed[n_event] != 0.) {
+                        energy_calibrated[n_event] = channel.energy_calibration(
+                            amplitude[n_event], batch.entries[n_event]);
+                    }
+                }
+            }
+            for (size_t n_event = 0; n_event < n_events; ++n_event) {
+                timestamp_calibrated[n_event] =
+                    timestamp[n_event] * INVERSE_VME_CLOCK_FREQUENCY;
+            }
+            invalidate_failed_events(gate_passed, energy_calibrated, n_events);
+            invalidate_failed_events(gate_passed, time_calibrated, n_events);
+            invalidate_failed_events(
+                gate_passed, time_vs_reference_time_calibrated, n_events);
+            invalidate_failed_events(gate_passed, timestamp_calibrated,
+                                     n_events);
+            ++n_channel_index;
+        }
+    }
+}
+
+void Analysis::load_from_batch(const CalibrationBatch &batch,
+                               const size_t n_event) {
+    CalibratedChannelTable &table = *calibrated_channels;
+    for (size_t n_channel_index = 0; n_channel_index < table.size();
+         ++n_channel_index) {
+        const size_t n = batch.index(n_channel_index, n_event);
+        if (isnan(batch.energy_calibrated[n]) &&
+            isnan(batch.time_calibrated[n]) &&
+            isnan(batch.time_vs_reference_time_calibrated[n]) &&
+            isnan(batch.timestamp_calibrated[n])) {
+            if (table.is_written(n_channel_index)) {
+                table.reset(n_channel_index);
+            }
+            continue;
+        }
+        table.mark_written(n_channel_index);
+        table.energy[n_channel_index] = batch.energy_calibrated[n];
+        table.time[n_channel_index] = batch.time_calibrated[n];
+        table.time_vs_reference_time[n_channel_index] =
+            batch.time_vs_reference_time_calibrated[n];
+        table.timestamp[n_channel_index] = batch.timestamp_calibrated[n];
+        table.set_valid(n_channel_index, !isnan(batch.energy_calibrated[n]));
+    }
+    for (const auto &detector : energy_sensitive_detectors) {
+        if (detector->channels.size() > 1) {
+            detector->addback();
+        }
+    }
+    update_hits();
+
+    size_t n_channel_index{0};
+    for (size_t n_detector = 0; n_detector < counter_detectors.size();
+         ++n_detector) {
+        for (size_t n_channel = 0;
+             n_channel < counter_detectors[n_detector]->channels.size();
+             ++n_channel) {
+            calibrate_counter_detector(
+                batch.entries[n_event], n_detector, n_channel,
+                batch.counts[batch.index(n_channel_index, n_event)]);
+            ++n_channel_index;
+        }
     }
 }
 
 void Analysis::reset_calibrated_leaves() {
-    for (size_t n_detector = 0; n_detector < detectors.size(); ++n_detector) {
-        detectors[n_detector]->reset_calibrated_leaves();
+    calibrated_channels->reset();
+    hit_detectors.clear();
+    for (const auto &detector : energy_sensitive_detectors) {
+        detector->reset_addback();
+    }
+    for (const auto &detector : counter_detectors) {
+        detector->reset_calibrated_leaves();
+    }
+}
+
+void Analysis::update_valid_channels() {
+    CalibratedChannelTable &table = *calibrated_channels;
+    size_t n_channel_index{0};
+    for (const auto &detector : energy_sensitive_detectors) {
+        for (const auto &channel : detector->channels) {
+            table.set_valid(n_channel_index,
+                            !isnan(table.energy[n_channel_index]) &&
+                                calibration_kernels[n_channel_index]
+                                    .time_vs_reference_time_gate(
+                                        channel, table.time_vs_reference_time
+                                                     [n_channel_index]));
+            ++n_channel_index;
+        }
+    }
+    update_hits();
+}
+
+void Analysis::update_hits() {
+    calibrated_channels->update_hits();
+    hit_detectors.clear();
+    for (const size_t n_channel_index : calibrated_channels->hits) {
+        const size_t n_detector = channel_detector_index[n_channel_index];
+        if (hit_detectors.empty() || hit_detectors.back() != n_detector) {
+            hit_detectors.push_back(n_detector);
+        }
     }
 }
 
@@ -0,0 +1,51 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+
+using std::abort;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include "calibration_batch.hpp"
+#include "analysis.hpp"
+
+CalibrationBatch::CalibrationBatch(const Analysis &analysis,
+                                   const size_t capacity)
+    : capacity(capacity), n_events(0), entries(capacity) {
+    if (capacity == 0) {
+        cout << "Error: a calibration batch needs a capacity of at least 1 "
+                "entry. Aborting ..."
+             << endl;
+        abort();
+    }
+    const size_t n_values =
+        analysis.get_n_energy_sensitive_detector_channels() * capacity;
+    amplitude.resize(n_values);
+    time.resize(n_values);
+    reference_time.resize(analysis.digitizer_modules.size() * capacity);
+    timestamp.resize(analysis.digitizer_modules.size() * capacity);
+    counts.resize(analysis.get_n_counter_detector_channels() * capacity);
+    energy_calibrated.resize(n_values);
+    time_calibrated.resize(n_values);
+    time_vs_reference_time_calibrated.resize(n_values);
+    timestamp_calibrated.resize(n_values);
+    gate_passed.resize(n_values);
+}
@@ -0,0 +1,103 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+using std::isnan;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <memory>
+
+using std::make_unique;
+
+#include "coincidence_matrix_set.hpp"
+#include "energy_sensitive_detector.hpp"
+
+CoincidenceMatrixSet::CoincidenceMatrixSet(const Analysis &analysis) {
+    const size_t n_detectors = analysis.energy_sensitive_detectors.size();
+    for (auto matrix : analysis.coincidence_matrices) {
+        histograms.push_back(make_unique<TiledHistogram2D>(
+            matrix.name, matrix.x_axis, matrix.y_axis));
+        pair_multiplicities.push_back(
+            vector<unsigned int>(n_detectors * n_detectors, 0));
+        for (auto detector_pair : matrix.get_coincidence_pairs()) {
+            ++pair_multiplicities.back()
+                  [analysis.detector_index[detector_pair.first] *
+                       n_detectors +
+                   analysis.detector_index[detector_pair.second]];
+        }
+    }
+    hits.reserve(n_detectors);
+}
+
+void CoincidenceMatrixSet::add(const CoincidenceMatrixSet &matrix_set) {
+    for (size_t n_matrix = 0; n_matrix < histograms.size(); ++n_matrix) {
+        histograms[n_matrix]->add(*matrix_set.histograms[n_matrix]);
+    }
+}
+
+void CoincidenceMatrixSet::fill(const Analysis &analysis) {
+    const size_t n_detectors = analysis.energy_sensitive_detectors.size();
+
+    hits.clear();
+    for (const size_t n_detector : analysis.hit_detectors) {
+        const double energy = analysis.energy_sensitive_detectors[n_detector]
+                                  ->get_calibrated_and_RF_gated_energy();
+        if (!isnan(energy)) {
+            hits.push_back({n_detector, energy});
+        }
+    }
+
+    for (size_t n_matrix = 0; n_matrix < histograms.size(); ++n_matrix) {
+        // Matrices without a list of detectors on the y axis are symmetric.
+        const bool symmetric =
+            analysis.coincidence_matrices[n_matrix].detectors_y.empty();
+        for (auto hit_1 : hits) {
+            const unsigned int *multiplicities =
+                &pair_multiplicities[n_matrix][hit_1.first * n_detectors];
+            for (auto hit_2 : hits) {
+                for (unsigned int n = 0; n < multiplicities[hit_2.first];
+                     ++n) {
+                    histograms[n_matrix]->fill(hit_1.second, hit_2.second);
+                    if (symmetric) {
+                        histograms[n_matrix]->fill(hit_2.second, hit_1.second);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void CoincidenceMatrixSet::write(const bool sparse) const {
+    for (const auto &histogram : histograms) {
+        cout << "'" << histogram->name << "': "
+             << histogram->get_n_allocated_tiles() << " tiles allocated, "
+             << histogram->get_memory_usage() << " bytes." << endl;
+        if (!sparse) {
+            cout << "Warning: writing '" << histogram->name
+                 << "' as a TH2I temporarily allocates "
+                 << (histogram->x_axis.n_bins + 2) *
+                        (histogram->y_axis.n_bins + 2) * sizeof(int)
+                 << " bytes." << endl;
+        }
+        histogram->write(sparse);
+    }
+}
@@ -0,0 +1,75 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+using std::isnan;
+
+#include "TH2D.h"
+
+#include "energy_sensitive_detector.hpp"
+#include "energy_sensitive_detector_channel.hpp"
+#include "energy_vs_time_set.hpp"
+
+EnergyVsTimeSet::EnergyVsTimeSet(const Analysis &analysis,
+                                 const unsigned int rebin_energy,
+                                 const unsigned int rebin_time) {
+    for (auto detector : analysis.energy_sensitive_detectors) {
+        const auto group =
+            analysis.energy_sensitive_detector_groups[analysis.group_index
+                                                          [detector->group]];
+        histograms.push_back(vector<CountingHistogram2D<>>());
+        for (auto channel : detector->channels) {
+            histograms.back().emplace_back(
+                detector->name + "_" + channel.name,
+                Histogram(
+                    group->histogram_properties.n_bins / rebin_energy,
+                    group->histogram_properties.lower_edge_of_first_bin,
+                    group->histogram_properties.upper_edge_of_last_bin),
+                Histogram(
+                    group->time_histogram_properties.n_bins / rebin_time,
+                    group->time_histogram_properties.lower_edge_of_first_bin,
+                    group->time_histogram_properties.upper_edge_of_last_bin));
+        }
+    }
+}
+
+void EnergyVsTimeSet::fill(const Analysis &analysis) {
+    for (size_t n_detector = 0;
+         n_detector < analysis.energy_sensitive_detectors.size();
+         ++n_detector) {
+        const auto &channels =
+            analysis.energy_sensitive_detectors[n_detector]->channels;
+        for (size_t n_channel = 0; n_channel < channels.size(); ++n_channel) {
+            const auto &channel = channels[n_channel];
+            if (!isnan(channel.energy_calibrated()) &&
+                channel.time_vs_reference_time_gate(
+                    channel.time_vs_reference_time_calibrated())) {
+                histograms[n_detector][n_channel].fill(
+                    channel.energy_calibrated(), channel.time_calibrated());
+            }
+        }
+    }
+}
+
+void EnergyVsTimeSet::write() const {
+    for (const auto &histogram_list : histograms) {
+        for (const auto &histogram : histogram_list) {
+            histogram.write<TH2D>();
+        }
+    }
+}
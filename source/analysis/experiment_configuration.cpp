@@ -0,0 +1,395 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <unistd.h>
+
+#include <cstdio>
+
+using std::remove;
+using std::rename;
+
+#include <cstdlib>
+
+using std::abort;
+
+#include <cstring>
+
+using std::memcmp;
+
+#include <fstream>
+
+using std::ifstream;
+using std::ios;
+using std::ofstream;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <memory>
+
+using std::make_shared;
+
+#include <string>
+
+using std::to_string;
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+using boost::property_tree::ptree;
+using boost::property_tree::ptree_error;
+
+#include "binary_archive.hpp"
+#include "coincidence_matrix.hpp"
+#include "counter_detector.hpp"
+#include "counter_detector_channel.hpp"
+#include "energy_sensitive_detector.hpp"
+#include "energy_sensitive_detector_channel.hpp"
+#include "experiment_configuration.hpp"
+#include "gate.hpp"
+#include "mdpp16_qdc.hpp"
+#include "mdpp16_scp.hpp"
+#include "polynomial.hpp"
+#include "sis3316.hpp"
+#include "v830.hpp"
+
+// Header of the cache file, followed by the serialized configuration.
+// Increase the version if the layout of the configuration changes.
+static const char cache_magic[8] = {'c', 'a', 'r', 'o', 'c', 'f', 'g', '\0'};
+static const uint32_t cache_version = 1;
+
+static HistogramConfiguration read_histogram(const ptree &tree) {
+    vector<double> values;
+    for (const auto &value : tree) {
+        values.push_back(value.second.get_value<double>());
+    }
+    if (values.size() != 3) {
+        throw ptree_error("a histogram needs three values [n_bins, "
+                          "lower_edge_of_first_bin, upper_edge_of_last_bin]");
+    }
+    return {(unsigned int)values[0], values[1], values[2]};
+}
+
+static GateConfiguration read_gate(const ptree &tree) {
+    vector<double> limits;
+    for (const auto &limit : tree) {
+        limits.push_back(limit.second.get_value<double>());
+    }
+    if (limits.size() != 2) {
+        throw ptree_error("a gate needs two values [lower, upper]");
+    }
+    return {false, limits[0], limits[1]};
+}
+
+// A polynomial is either an array of parameters or a string in the format of
+// Polynomial.
+static vector<double> read_polynomial(const ptree &tree) {
+    if (tree.empty()) {
+        return Polynomial(tree.get_value<string>()).parameters;
+    }
+    vector<double> parameters;
+    for (const auto &parameter : tree) {
+        parameters.push_back(parameter.second.get_value<double>());
+    }
+    return parameters;
+}
+
+static vector<uint64_t> read_indices(const ptree &tree) {
+    vector<uint64_t> indices;
+    for (const auto &index : tree) {
+        indices.push_back(index.second.get_value<uint64_t>());
+    }
+    return indices;
+}
+
+void ExperimentConfiguration::read_json(const string &file_name) {
+    const GateConfiguration open_gate{true, 0., 0.};
+    ptree tree;
+    try {
+        boost::property_tree::read_json(file_name, tree);
+
+        for (const auto &entry : tree.get_child("modules")) {
+            const ptree &module = entry.second;
+            modules.push_back(
+                {module.get<string>("type"),
+                 module.get<unsigned int>("address"),
+                 module.get<string>("amplitude_branch", "amplitude"),
+                 module.get<string>("time_branch", "time"),
+                 module.get<string>("reference_time_branch", "reference_time"),
+                 module.get<string>("timestamp_branch", "timestamp"),
+                 module.get<double>("trigger_frequency", 0.)});
+        }
+
+        for (const auto &entry : tree.get_child("groups")) {
+            const ptree &group = entry.second;
+            GroupConfiguration group_configuration{
+                group.get<string>("type"), group.get<string>("name"),
+                read_histogram(group.get_child("histogram")),
+                read_histogram(group.get_child("raw_histogram")),
+                {0, 0., 0.},
+                {0, 0., 0.}};
+            if (group_configuration.type == "energy_sensitive") {
+                group_configuration.time_histogram =
+                    read_histogram(group.get_child("time_histogram"));
+                group_configuration.raw_time_histogram =
+                    read_histogram(group.get_child("raw_time_histogram"));
+            }
+            groups.push_back(group_configuration);
+        }
+
+        for (const auto &entry : tree.get_child("detectors")) {
+            const ptree &detector = entry.second;
+            DetectorConfiguration detector_configuration{
+                detector.get<string>("type"),
+                detector.get<string>("name"),
+                detector.get<uint64_t>("group"),
+                {},
+                {}};
+            for (const auto &channel_entry : detector.get_child("channels")) {
+                const ptree &channel = channel_entry.second;
+                const auto energy_calibration =
+                    channel.get_child_optional("energy_calibration");
+                const auto time_calibration =
+                    channel.get_child_optional("time_calibration");
+                const auto gate =
+                    channel.get_child_optional("time_vs_reference_time_gate");
+                detector_configuration.channels.push_back(
+                    {channel.get<string>("name"),
+                     channel.get<uint64_t>("module"),
+                     channel.get<uint64_t>("channel"),
+                     energy_calibration ? read_polynomial(*energy_calibration)
+                                        : vector<double>{0., 1.},
+                     time_calibration ? read_polynomial(*time_calibration)
+                                      : vector<double>{0., 1.},
+                     gate ? read_gate(*gate) : open_gate});
+            }
+            const auto addback_gates =
+                detector.get_child_optional("addback_gates");
+            if (addback_gates) {
+                for (const auto &row : *addback_gates) {
+                    detector_configuration.addback_gates.push_back({});
+                    for (const auto &gate : row.second) {
+                        detector_configuration.addback_gates.back().push_back(
+                            read_gate(gate.second));
+                    }
+                }
+            }
+            detectors.push_back(detector_configuration);
+        }
+
+        const auto matrices = tree.get_child_optional("coincidence_matrices");
+        if (matrices) {
+            for (const auto &entry : *matrices) {
+                const ptree &matrix = entry.second;
+                coincidence_matrices.push_back(
+                    {matrix.get<string>("name"),
+                     read_indices(matrix.get_child("detectors_x")),
+                     read_indices(matrix.get_child("detectors_y")),
+                     read_histogram(matrix.get_child("x_axis")),
+                     read_histogram(matrix.get_child("y_axis"))});
+            }
+        }
+    } catch (const ptree_error &error) {
+        cout << "Error: could not read experiment configuration '" << file_name
+             << "': " << error.what() << ". Aborting ..." << endl;
+        abort();
+    }
+}
+
+bool ExperimentConfiguration::read_cache(const string &cache_file_name,
+                                         const string &file_name) {
+    int64_t size, modification_time;
+    if (!get_file_version(file_name, size, modification_time)) {
+        return false;
+    }
+    ifstream file(cache_file_name, ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    char magic[sizeof(cache_magic)];
+    file.read(magic, sizeof(magic));
+    uint32_t version = 0;
+    int64_t cached_size = -1, cached_modification_time = -1;
+    BinaryReader reader(file);
+    reader(version, cached_size, cached_modification_time);
+    if (!file.good() || memcmp(magic, cache_magic, sizeof(magic)) ||
+        version != cache_version || cached_size != size ||
+        cached_modification_time != modification_time) {
+        return false;
+    }
+
+    ExperimentConfiguration configuration;
+    configuration.serialize(reader);
+    if (!file.good()) {
+        return false;
+    }
+    *this = configuration;
+    return true;
+}
+
+void ExperimentConfiguration::write_cache(const string &cache_file_name,
+                                          const string &file_name) {
+    int64_t size, modification_time;
+    if (!get_file_version(file_name, size, modification_time)) {
+        return;
+    }
+    // The cache is only an optimization, so a file that cannot be written
+    // (for example in a read-only directory) is silently skipped.
+    // It is written to a temporary file first, which is then renamed, so
+    // that programs that start in parallel never read an incomplete cache.
+    const string temporary_file_name =
+        cache_file_name + "." + to_string(getpid()) + ".tmp";
+    {
+        ofstream file(temporary_file_name, ios::binary);
+        if (!file.is_open()) {
+            return;
+        }
+        file.write(cache_magic, sizeof(cache_magic));
+        BinaryWriter writer(file);
+        uint32_t version = cache_version;
+        writer(version, size, modification_time);
+        serialize(writer);
+        if (!file.good()) {
+            file.close();
+            remove(temporary_file_name.c_str());
+            return;
+        }
+    }
+    if (rename(temporary_file_name.c_str(), cache_file_name.c_str())) {
+        remove(temporary_file_name.c_str());
+    }
+}
+
+static Histogram create_histogram(const HistogramConfiguration &histogram) {
+    return Histogram{histogram.n_bins, histogram.lower_edge_of_first_bin,
+                     histogram.upper_edge_of_last_bin};
+}
+
+static function<bool(const double)>
+create_gate(const GateConfiguration &gate) {
+    if (gate.open) {
+        return OpenGate();
+    }
+    return Gate(gate.lower_limit, gate.upper_limit);
+}
+
+Analysis ExperimentConfiguration::create_analysis() const {
+    vector<shared_ptr<Module>> analysis_modules;
+    for (const auto &module : modules) {
+        if (module.type == "MDPP16_SCP") {
+            analysis_modules.push_back(make_shared<MDPP16_SCP>(
+                module.address, module.amplitude_branch, module.time_branch,
+                module.reference_time_branch, module.timestamp_branch));
+        } else if (module.type == "MDPP16_QDC") {
+            analysis_modules.push_back(make_shared<MDPP16_QDC>(
+                module.address, module.amplitude_branch, module.time_branch,
+                module.reference_time_branch, module.timestamp_branch));
+        } else if (module.type == "SIS3316") {
+            analysis_modules.push_back(make_shared<SIS3316>(module.address));
+        } else if (module.type == "V830") {
+            analysis_modules.push_back(
+                make_shared<V830>(module.address, module.trigger_frequency));
+        } else {
+            cout << "Error: unknown module type '" << module.type
+                 << "'. Aborting ..." << endl;
+            abort();
+        }
+    }
+
+    vector<shared_ptr<DetectorGroup>> detector_groups;
+    for (const auto &group : groups) {
+        if (group.type == "energy_sensitive") {
+            detector_groups.push_back(make_shared<EnergySensitiveDetectorGroup>(
+                group.name, create_histogram(group.histogram),
+                create_histogram(group.raw_histogram),
+                create_histogram(group.time_histogram),
+                create_histogram(group.raw_time_histogram)));
+        } else if (group.type == "counter") {
+            detector_groups.push_back(make_shared<CounterDetectorGroup>(
+                group.name, create_histogram(group.histogram),
+                create_histogram(group.raw_histogram)));
+        } else {
+            cout << "Error: unknown detector group type '" << group.type
+                 << "'. Aborting ..." << endl;
+            abort();
+        }
+    }
+
+    vector<shared_ptr<Detector>> analysis_detectors;
+    for (const auto &detector : detectors) {
+        if (detector.type == "energy_sensitive") {
+            vector<EnergySensitiveDetectorChannel> channels;
+            for (const auto &channel : detector.channels) {
+                channels.push_back(
+                    {channel.name, channel.module, channel.channel,
+                     Polynomial(channel.energy_calibration),
+                     Polynomial(channel.time_calibration),
+                     create_gate(channel.time_vs_reference_time_gate)});
+            }
+            vector<vector<function<bool(const double)>>> addback_gates;
+            for (const auto &row : detector.addback_gates) {
+                addback_gates.push_back({});
+                for (const auto &gate : row) {
+                    addback_gates.back().push_back(create_gate(gate));
+                }
+            }
+            analysis_detectors.push_back(make_shared<EnergySensitiveDetector>(
+                detector.name, channels, detector.group, addback_gates));
+        } else if (detector.type == "counter") {
+            vector<CounterDetectorChannel> channels;
+            for (const auto &channel : detector.channels) {
+                channels.push_back(
+                    {channel.name, channel.module, channel.channel});
+            }
+            analysis_detectors.push_back(make_shared<CounterDetector>(
+                detector.name, channels, detector.group));
+        } else {
+            cout << "Error: unknown detector type '" << detector.type
+                 << "'. Aborting ..." << endl;
+            abort();
+        }
+    }
+
+    vector<CoincidenceMatrix> matrices;
+    for (const auto &matrix : coincidence_matrices) {
+        matrices.push_back({matrix.name,
+                            vector<size_t>(matrix.detectors_x.begin(),
+                                           matrix.detectors_x.end()),
+                            vector<size_t>(matrix.detectors_y.begin(),
+                                           matrix.detectors_y.end()),
+                            create_histogram(matrix.x_axis),
+                            create_histogram(matrix.y_axis)});
+    }
+
+    return Analysis(analysis_modules, detector_groups, analysis_detectors,
+                    matrices);
+}
+
+Analysis load_analysis(const string &file_name,
+                       const string &cache_file_name) {
+    const string cache =
+        cache_file_name.empty() ? file_name + ".cache" : cache_file_name;
+    ExperimentConfiguration configuration;
+    if (!configuration.read_cache(cache, file_name)) {
+        configuration.read_json(file_name);
+        configuration.write_cache(cache, file_name);
+    }
+    return configuration.create_analysis();
+}
@@ -0,0 +1,380 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#include <cmath>
+
+using std::isnan;
+
+#include <fstream>
+
+using std::ifstream;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <memory>
+
+using std::make_unique;
+
+#include <string>
+
+using std::string;
+
+#include "TDirectory.h"
+
+#include "histogram_set_1d.hpp"
+
+TimeDifferencePairSelection::TimeDifferencePairSelection(
+    const string selection) {
+    if (selection == "all") {
+        mode = Mode::all;
+    } else if (selection == "detector") {
+        mode = Mode::same_detector;
+    } else if (selection == "group") {
+        mode = Mode::same_group;
+    } else {
+        mode = Mode::list;
+        ifstream file(selection);
+        if (!file.is_open()) {
+            cout << "Error: could not open list of time-difference pairs '"
+                 << selection << "'." << endl;
+            abort();
+        }
+        string channel_name_1, channel_name_2;
+        while (file >> channel_name_1 >> channel_name_2) {
+            pairs.insert({channel_name_1, channel_name_2});
+            pairs.insert({channel_name_2, channel_name_1});
+        }
+    }
+}
+
+bool TimeDifferencePairSelection::is_selected(const Analysis &analysis,
+                                              const size_t n_detector_1,
+                                              const size_t n_channel_1,
+                                              const size_t n_detector_2,
+                                              const size_t n_channel_2) const {
+    const auto detector_1 = analysis.energy_sensitive_detectors[n_detector_1];
+    const auto detector_2 = analysis.energy_sensitive_detectors[n_detector_2];
+    switch (mode) {
+    case Mode::all:
+        return true;
+    case Mode::same_detector:
+        return n_detector_1 == n_detector_2;
+    case Mode::same_group:
+        return detector_1->group == detector_2->group;
+    case Mode::list:
+        return pairs.count({detector_1->name + "_" +
+                                detector_1->channels[n_channel_1].name,
+                            detector_2->name + "_" +
+                                detector_2->channels[n_channel_2].name}) > 0;
+    }
+    return false;
+}
+
+HistogramSet1D::HistogramSet1D(
+    const Analysis &analysis,
+    const TimeDifferencePairSelection &time_difference_pairs) {
+    string histogram_name;
+
+    for (size_t n_detector_1 = 0;
+         n_detector_1 < analysis.energy_sensitive_detectors.size();
+         ++n_detector_1) {
+        const auto detector_1 =
+            analysis.energy_sensitive_detectors[n_detector_1];
+        const auto group_1 =
+            analysis.energy_sensitive_detector_groups[analysis.group_index
+                                                          [detector_1->group]];
+        if (detector_1->channels.size() > 1) {
+            addback_histograms.push_back(make_unique<CountingHistogram1D<>>(
+                detector_1->name + "_addback", group_1->histogram_properties));
+        } else {
+            addback_histograms.push_back(nullptr);
+        }
+        energy_sensitive_detector_histograms.push_back(
+            vector<CountingHistogram1D<>>());
+        time_difference_histograms.push_back(
+            vector<vector<vector<unique_ptr<CountingHistogram1D<>>>>>());
+        time_difference_selected.push_back(vector<vector<vector<bool>>>());
+        channel_names.push_back(vector<string>());
+        time_vs_reference_time_histograms.push_back(
+            vector<CountingHistogram1D<>>());
+        for (size_t n_channel_1 = 0; n_channel_1 < detector_1->channels.size();
+             ++n_channel_1) {
+            time_difference_histograms[n_detector_1].push_back(
+                vector<vector<unique_ptr<CountingHistogram1D<>>>>());
+            time_difference_selected[n_detector_1].push_back(
+                vector<vector<bool>>());
+            histogram_name =
+                detector_1->name + "_" + detector_1->channels[n_channel_1].name;
+            channel_names[n_detector_1].push_back(histogram_name);
+            energy_sensitive_detector_histograms[n_detector_1].emplace_back(
+                histogram_name, group_1->histogram_properties);
+            time_vs_reference_time_histograms[n_detector_1].emplace_back(
+                histogram_name + "_t_vs_RF",
+                group_1->time_histogram_properties);
+
+            for (size_t n_detector_2 = n_detector_1;
+                 n_detector_2 < analysis.energy_sensitive_detectors.size();
+                 ++n_detector_2) {
+                const size_t n_channels_2 =
+                    n_detector_2 == n_detector_1
+                        ? detector_1->channels.size() - n_channel_1 - 1
+                        : analysis.energy_sensitive_detectors[n_detector_2]
+                              ->channels.size();
+                const size_t first_channel_2 =
+                    n_detector_2 == n_detector_1 ? n_channel_1 + 1 : 0;
+                time_difference_histograms[n_detector_1][n_channel_1].push_back(
+                    vector<unique_ptr<CountingHistogram1D<>>>(n_channels_2));
+                time_difference_selected[n_detector_1][n_channel_1].push_back(
+                    vector<bool>());
+                for (size_t n_channel_2 = first_channel_2;
+                     n_channel_2 < first_channel_2 + n_channels_2;
+                     ++n_channel_2) {
+                    time_difference_selected[n_detector_1][n_channel_1]
+                                            [n_detector_2 - n_detector_1]
+                                                .push_back(
+                                                    time_difference_pairs
+                                                        .is_selected(
+                                                            analysis,
+                                                            n_detector_1,
+                                                            n_channel_1,
+                                                            n_detector_2,
+                                                            n_channel_2));
+                }
+            }
+        }
+
+        time_difference_binnings.push_back(vector<Histogram>());
+        for (size_t n_detector_2 = n_detector_1;
+             n_detector_2 < analysis.energy_sensitive_detectors.size();
+             ++n_detector_2) {
+            const auto group_2 =
+                analysis.energy_sensitive_detector_groups
+                    [analysis.group_index
+                         [analysis.energy_sensitive_detectors[n_detector_2]
+                              ->group]];
+            time_difference_binnings[n_detector_1].push_back(Histogram(
+                max(group_1->time_histogram_properties.n_bins,
+                    group_2->time_histogram_properties.n_bins),
+                min(group_1->time_histogram_properties.lower_edge_of_first_bin,
+                    group_2->time_histogram_properties.lower_edge_of_first_bin),
+                max(group_1->time_histogram_properties.upper_edge_of_last_bin,
+                    group_2->time_histogram_properties
+                        .upper_edge_of_last_bin)));
+        }
+    }
+    for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
+         ++n_detector) {
+        const auto detector = analysis.counter_detectors[n_detector];
+        const auto group =
+            analysis.counter_detector_groups[analysis.group_index
+                                                 [detector->group]];
+        counter_detector_histograms.push_back(vector<CountingHistogram1D<>>());
+        for (auto channel : detector->channels) {
+            counter_detector_histograms[n_detector].emplace_back(
+                detector->name + "_" + channel.name,
+                group->histogram_properties);
+        }
+    }
+}
+
+void HistogramSet1D::add(const HistogramSet1D &histogram_set) {
+    for (size_t n_detector_1 = 0; n_detector_1 < addback_histograms.size();
+         ++n_detector_1) {
+        if (addback_histograms[n_detector_1] != nullptr) {
+            addback_histograms[n_detector_1]->add(
+                *histogram_set.addback_histograms[n_detector_1]);
+        }
+        for (size_t n_channel_1 = 0;
+             n_channel_1 <
+             energy_sensitive_detector_histograms[n_detector_1].size();
+             ++n_channel_1) {
+            energy_sensitive_detector_histograms[n_detector_1][n_channel_1].add(
+                histogram_set
+                    .energy_sensitive_detector_histograms[n_detector_1]
+                                                         [n_channel_1]);
+            time_vs_reference_time_histograms[n_detector_1][n_channel_1].add(
+                histogram_set.time_vs_reference_time_histograms[n_detector_1]
+                                                               [n_channel_1]);
+            for (size_t n_detector_2 = 0;
+                 n_detector_2 <
+                 time_difference_histograms[n_detector_1][n_channel_1].size();
+                 ++n_detector_2) {
+                auto &histograms =
+                    time_difference_histograms[n_detector_1][n_channel_1]
+                                              [n_detector_2];
+                const auto &other_histograms =
+                    histogram_set.time_difference_histograms
+                        [n_detector_1][n_channel_1][n_detector_2];
+                for (size_t n_channel_2 = 0; n_channel_2 < histograms.size();
+                     ++n_channel_2) {
+                    if (other_histograms[n_channel_2] == nullptr) {
+                        continue;
+                    }
+                    if (histograms[n_channel_2] == nullptr) {
+                        histograms[n_channel_2] =
+                            make_unique<CountingHistogram1D<>>(
+                                other_histograms[n_channel_2]->name,
+                                time_difference_binnings[n_detector_1]
+                                                        [n_detector_2]);
+                    }
+                    histograms[n_channel_2]->add(*other_histograms[n_channel_2]);
+                }
+            }
+        }
+    }
+    for (size_t n_detector = 0; n_detector < counter_detector_histograms.size();
+         ++n_detector) {
+        for (size_t n_channel = 0;
+             n_channel < counter_detector_histograms[n_detector].size();
+             ++n_channel) {
+            counter_detector_histograms[n_detector][n_channel].add(
+                histogram_set.counter_detector_histograms[n_detector][n_channel]);
+        }
+    }
+}
+
+void HistogramSet1D::fill(const Analysis &analysis) {
+    const CalibratedChannelTable &table = *analysis.calibrated_channels;
+    const vector<size_t> &hits = table.hits;
+
+    for (size_t n_hit_1 = 0; n_hit_1 < hits.size(); ++n_hit_1) {
+        const size_t index_1 = hits[n_hit_1];
+        const size_t n_detector_1 = analysis.channel_detector_index[index_1];
+        const size_t n_channel_1 =
+            index_1 - analysis.first_channel_index[n_detector_1];
+        energy_sensitive_detector_histograms[n_detector_1][n_channel_1].fill(
+            table.energy[index_1]);
+        time_vs_reference_time_histograms[n_detector_1][n_channel_1].fill(
+            table.time_vs_reference_time[index_1]);
+
+        // The hits are sorted by channel index, so all following hits belong
+        // to the same or a following detector.
+        for (size_t n_hit_2 = n_hit_1 + 1; n_hit_2 < hits.size(); ++n_hit_2) {
+            const size_t index_2 = hits[n_hit_2];
+            const size_t n_detector_2 =
+                analysis.channel_detector_index[index_2];
+            fill_time_difference(
+                n_detector_1, n_channel_1, n_detector_2 - n_detector_1,
+                n_detector_2 == n_detector_1
+                    ? index_2 - index_1 - 1
+                    : index_2 - analysis.first_channel_index[n_detector_2],
+                table.time[index_1] - table.time[index_2]);
+        }
+    }
+    for (const size_t n_detector : analysis.hit_detectors) {
+        const auto detector = analysis.energy_sensitive_detectors[n_detector];
+        if (detector->channels.size() > 1 &&
+            !isnan(detector->addback_energy)) {
+            addback_histograms[n_detector]->fill(detector->addback_energy);
+        }
+    }
+    for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
+         ++n_detector) {
+        for (size_t n_channel = 0;
+             n_channel < analysis.counter_detectors[n_detector]->channels.size();
+             ++n_channel) {
+            if (!isnan(analysis.counter_detectors[n_detector]
+                           ->channels[n_channel]
+                           .count_rate)) {
+                counter_detector_histograms[n_detector][n_channel].fill(
+                    analysis.counter_detectors[n_detector]
+                        ->channels[n_channel]
+                        .count_rate);
+            }
+        }
+    }
+}
+
+void HistogramSet1D::fill_time_difference(const size_t n_detector_1,
+                                          const size_t n_channel_1,
+                                          const size_t n_detector_offset,
+                                          const size_t n_channel_2,
+                                          const double value) {
+    if (!time_difference_selected[n_detector_1][n_channel_1][n_detector_offset]
+                                 [n_channel_2]) {
+        return;
+    }
+    unique_ptr<CountingHistogram1D<>> &histogram =
+        time_difference_histograms[n_detector_1][n_channel_1]
+                                  [n_detector_offset][n_channel_2];
+    if (histogram == nullptr) {
+        const string histogram_name =
+            channel_names[n_detector_1][n_channel_1] + "_" +
+            channel_names[n_detector_1 + n_detector_offset]
+                         [n_detector_offset == 0 ? n_channel_1 + n_channel_2 + 1
+                                                 : n_channel_2] +
+            "_tdiff";
+        histogram = make_unique<CountingHistogram1D<>>(
+            histogram_name,
+            time_difference_binnings[n_detector_1][n_detector_offset]);
+    }
+    histogram->fill(value);
+}
+
+void HistogramSet1D::write(const Analysis &analysis,
+                           TFile &output_file) const {
+    TDirectory *directory = nullptr;
+
+    for (size_t n_detector_1 = 0;
+         n_detector_1 < analysis.energy_sensitive_detectors.size();
+         ++n_detector_1) {
+        directory = output_file.mkdir(
+            (analysis.energy_sensitive_detectors[n_detector_1]->name + "_tdiff")
+                .c_str());
+        if (analysis.energy_sensitive_detectors[n_detector_1]->channels.size() >
+            1) {
+            addback_histograms[n_detector_1]->write<TH1D>();
+        }
+        for (size_t n_channel_1 = 0;
+             n_channel_1 <
+             analysis.energy_sensitive_detectors[n_detector_1]->channels.size();
+             ++n_channel_1) {
+            energy_sensitive_detector_histograms[n_detector_1][n_channel_1]
+                .write<TH1D>();
+            directory->cd();
+            time_vs_reference_time_histograms[n_detector_1][n_channel_1]
+                .write<TH1D>();
+
+            for (const auto &histograms :
+                 time_difference_histograms[n_detector_1][n_channel_1]) {
+                for (const auto &histogram : histograms) {
+                    if (histogram != nullptr) {
+                        histogram->write<TH1D>();
+                    }
+                }
+            }
+            output_file.cd();
+        }
+    }
+    for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
+         ++n_detector) {
+        for (size_t n_channel = 0;
+             n_channel <
+             analysis.counter_detectors[n_detector]->channels.size();
+             ++n_channel) {
+            counter_detector_histograms[n_detector][n_channel].write<TH1D>();
+        }
+    }
+}
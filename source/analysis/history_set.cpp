@@ -0,0 +1,96 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+
+using std::isnan;
+
+#include "TH2I.h"
+
+#include "counter_detector.hpp"
+#include "counter_detector_channel.hpp"
+#include "energy_sensitive_detector.hpp"
+#include "energy_sensitive_detector_channel.hpp"
+#include "history_set.hpp"
+
+HistorySet::HistorySet(const Analysis &analysis, const long long first,
+                       const long long last) {
+    const Histogram entry_histogram_properties(256, first, last);
+
+    for (auto detector : analysis.energy_sensitive_detectors) {
+        energy_sensitive_detector_histograms.push_back(
+            vector<CountingHistogram2D<>>());
+        for (auto channel : detector->channels) {
+            energy_sensitive_detector_histograms.back().emplace_back(
+                detector->name + "_" + channel.name,
+                entry_histogram_properties,
+                analysis
+                    .energy_sensitive_detector_groups[analysis.group_index
+                                                          [detector->group]]
+                    ->histogram_properties);
+        }
+    }
+    for (auto detector : analysis.counter_detectors) {
+        counter_detector_histograms.push_back(vector<CountingHistogram2D<>>());
+        for (auto channel : detector->channels) {
+            counter_detector_histograms.back().emplace_back(
+                detector->name + "_" + channel.name,
+                entry_histogram_properties,
+                analysis.counter_detector_groups[analysis.group_index
+                                                     [detector->group]]
+                    ->histogram_properties);
+        }
+    }
+}
+
+void HistorySet::fill(const Analysis &analysis, const long long n_entry) {
+    for (size_t n_detector = 0;
+         n_detector < analysis.energy_sensitive_detectors.size();
+         ++n_detector) {
+        const auto &channels =
+            analysis.energy_sensitive_detectors[n_detector]->channels;
+        for (size_t n_channel = 0; n_channel < channels.size(); ++n_channel) {
+            if (!isnan(channels[n_channel].energy_calibrated())) {
+                energy_sensitive_detector_histograms[n_detector][n_channel]
+                    .fill(n_entry, channels[n_channel].energy_calibrated());
+            }
+        }
+    }
+    for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
+         ++n_detector) {
+        const auto &channels = analysis.counter_detectors[n_detector]->channels;
+        for (size_t n_channel = 0; n_channel < channels.size(); ++n_channel) {
+            if (!isnan(channels[n_channel].count_rate)) {
+                counter_detector_histograms[n_detector][n_channel].fill(
+                    n_entry, channels[n_channel].count_rate);
+            }
+        }
+    }
+}
+
+void HistorySet::write() const {
+    for (const auto &histogram_list : energy_sensitive_detector_histograms) {
+        for (const auto &histogram : histogram_list) {
+            histogram.write<TH2I>();
+        }
+    }
+    for (const auto &histogram_list : counter_detector_histograms) {
+        for (const auto &histogram : histogram_list) {
+            histogram.write<TH2I>();
+        }
+    }
+}
@@ -0,0 +1,139 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "tiled_histogram_2d.hpp"
+
+TiledHistogram2D::TiledHistogram2D(const string name,
+                                   const Histogram &x_properties,
+                                   const Histogram &y_properties)
+    : name(name), x_axis(x_properties), y_axis(y_properties),
+      n_tiles_x((x_axis.n_bins + 2 + tile_size - 1) / tile_size),
+      n_tiles_y((y_axis.n_bins + 2 + tile_size - 1) / tile_size),
+      tiles(n_tiles_x * n_tiles_y), n_entries(0) {}
+
+uint64_t TiledHistogram2D::get_bin_content(const size_t x_bin,
+                                           const size_t y_bin) const {
+    const unique_ptr<Tile> &tile =
+        tiles[(y_bin / tile_size) * n_tiles_x + x_bin / tile_size];
+    if (tile == nullptr) {
+        return 0;
+    }
+    return (*tile)[(y_bin % tile_size) * tile_size + x_bin % tile_size];
+}
+
+size_t TiledHistogram2D::get_n_allocated_tiles() const {
+    size_t n_allocated_tiles = 0;
+    for (const auto &tile : tiles) {
+        if (tile != nullptr) {
+            ++n_allocated_tiles;
+        }
+    }
+    return n_allocated_tiles;
+}
+
+size_t TiledHistogram2D::get_memory_usage() const {
+    return tiles.size() * sizeof(unique_ptr<Tile>) +
+           get_n_allocated_tiles() * sizeof(Tile);
+}
+
+void TiledHistogram2D::add(const TiledHistogram2D &histogram) {
+    for (size_t n_tile = 0; n_tile < tiles.size(); ++n_tile) {
+        if (histogram.tiles[n_tile] == nullptr) {
+            continue;
+        }
+        if (tiles[n_tile] == nullptr) {
+            tiles[n_tile] = make_unique<Tile>(*histogram.tiles[n_tile]);
+            continue;
+        }
+        for (size_t n = 0; n < tile_size * tile_size; ++n) {
+            (*tiles[n_tile])[n] += (*histogram.tiles[n_tile])[n];
+        }
+    }
+    n_entries += histogram.n_entries;
+}
+
+THnSparseI *TiledHistogram2D::to_THnSparse() const {
+    const int n_bins[2] = {(int)x_axis.n_bins, (int)y_axis.n_bins};
+    const double lower_edges[2] = {x_axis.lower_edge_of_first_bin,
+                                   y_axis.lower_edge_of_first_bin};
+    const double upper_edges[2] = {x_axis.upper_edge_of_last_bin,
+                                   y_axis.upper_edge_of_last_bin};
+    THnSparseI *histogram = new THnSparseI(name.c_str(), name.c_str(), 2,
+                                           n_bins, lower_edges, upper_edges);
+
+    int bin[2];
+    for (size_t n_tile_y = 0; n_tile_y < n_tiles_y; ++n_tile_y) {
+        for (size_t n_tile_x = 0; n_tile_x < n_tiles_x; ++n_tile_x) {
+            const unique_ptr<Tile> &tile =
+                tiles[n_tile_y * n_tiles_x + n_tile_x];
+            if (tile == nullptr) {
+                continue;
+            }
+            for (size_t n = 0; n < tile_size * tile_size; ++n) {
+                if ((*tile)[n] == 0) {
+                    continue;
+                }
+                bin[0] = n_tile_x * tile_size + n % tile_size;
+                bin[1] = n_tile_y * tile_size + n / tile_size;
+                histogram->SetBinContent(bin, (*tile)[n]);
+            }
+        }
+    }
+    histogram->SetEntries(n_entries);
+    return histogram;
+}
+
+TH2I *TiledHistogram2D::to_TH2I() const {
+    TH2I *histogram =
+        new TH2I(name.c_str(), name.c_str(), x_axis.n_bins,
+                 x_axis.lower_edge_of_first_bin, x_axis.upper_edge_of_last_bin,
+                 y_axis.n_bins, y_axis.lower_edge_of_first_bin,
+                 y_axis.upper_edge_of_last_bin);
+
+    for (size_t n_tile_y = 0; n_tile_y < n_tiles_y; ++n_tile_y) {
+        for (size_t n_tile_x = 0; n_tile_x < n_tiles_x; ++n_tile_x) {
+            const unique_ptr<Tile> &tile =
+                tiles[n_tile_y * n_tiles_x + n_tile_x];
+            if (tile == nullptr) {
+                continue;
+            }
+            for (size_t n = 0; n < tile_size * tile_size; ++n) {
+                if ((*tile)[n] == 0) {
+                    continue;
+                }
+                histogram->SetBinContent(n_tile_x * tile_size + n % tile_size,
+                                         n_tile_y * tile_size + n / tile_size,
+                                         (*tile)[n]);
+            }
+        }
+    }
+    histogram->ResetStats();
+    histogram->SetEntries(n_entries);
+    return histogram;
+}
+
+void TiledHistogram2D::write(const bool sparse) const {
+    if (sparse) {
+        THnSparseI *histogram = to_THnSparse();
+        histogram->Write();
+        delete histogram;
+    } else {
+        TH2I *histogram = to_TH2I();
+        histogram->Write();
+        delete histogram;
+    }
+}
@@ -47,8 +47,7 @@ EnergySensitiveDetector::EnergySensitiveDetector(
             addback_coincidence_gates.push_back(
                 vector<function<bool(const double)>>());
             for (size_t n_c_1 = n_c_0 + 1; n_c_1 < channels.size(); n_c_1++) {
-                addback_coincidence_gates[n_c_0].push_back(
-                    [](const double) { return true; });
+                addback_coincidence_gates[n_c_0].push_back(OpenGate());
             }
         }
     } else {
@@ -77,74 +76,133 @@ EnergySensitiveDetector::EnergySensitiveDetector(
         }
     }
 
-    skip_channel = vector<bool>(channels.size(), false);
-    addback_energies =
-        vector<double>(channels.size(), numeric_limits<double>::quiet_NaN());
-    addback_times =
-        vector<double>(channels.size(), numeric_limits<double>::quiet_NaN());
+    if (channels.size() > max_n_channels) {
+        throw invalid_argument("A detector can have at most " +
+                               to_string(max_n_channels) + " channels, but '" +
+                               name + "' has " + to_string(channels.size()) +
+                               ".");
+    }
+
+    for (size_t n_c_0 = 0; n_c_0 < channels.size(); ++n_c_0) {
+        for (size_t n_c_1 = 0; n_c_1 < channels.size(); ++n_c_1) {
+            addback_gate_kernels.push_back(
+                n_c_1 > n_c_0
+                    ? GateKernel(
+                          addback_coincidence_gates[n_c_0][n_c_1 - n_c_0 - 1])
+                    : GateKernel(OpenGate()));
+        }
+    }
+    addback_energies.fill(numeric_limits<double>::quiet_NaN());
+    addback_times.fill(numeric_limits<double>::quiet_NaN());
 }
 
-void EnergySensitiveDetector::filter_addback() {
+uint32_t EnergySensitiveDetector::get_hit_mask() const {
+    uint32_t hits = 0;
     for (size_t n_channel = 0; n_channel < channels.size(); ++n_channel) {
+        hits |= uint32_t(!isnan(channels[n_channel].energy_calibrated()))
+                << n_channel;
+    }
+    return hits;
+}
+
+bool EnergySensitiveDetector::addback_gate(const size_t n_c_0,
+                                           const size_t n_c_1,
+                                           const double time_difference) const {
+    const GateKernel &gate =
+        addback_gate_kernels[n_c_0 * channels.size() + n_c_1];
+    switch (gate.type) {
+    case GateKernel::Type::open:
+        return true;
+    case GateKernel::Type::interval:
+        return (time_difference > gate.lower_limit) &&
+               (time_difference < gate.upper_limit);
+    default:
+        return addback_coincidence_gates[n_c_0][n_c_1 - n_c_0 - 1](
+            time_difference);
+    }
+}
+
+void EnergySensitiveDetector::filter_addback(const uint32_t first_channels) {
+    for (uint32_t channels_left = first_channels; channels_left != 0;
+         channels_left &= channels_left - 1) {
+        const size_t n_channel = __builtin_ctz(channels_left);
         if (isnan(addback_energy) ||
             addback_energies[n_channel] > addback_energy) {
             addback_energy = addback_energies[n_channel];
             addback_time = addback_times[n_channel];
             addback_time_vs_reference_time =
-                channels[n_channel].time_vs_reference_time_calibrated;
+                channels[n_channel].time_vs_reference_time_calibrated();
         }
     }
 }
 
+// Starting from the lowest channel with an energy, every channel opens a
+// cluster that absorbs all following channels which are still unassigned and
+// coincident with it. The time of a cluster is the time of the channel with
+// the highest energy deposition. The cluster with the highest total energy is
+// the addback result.
 void EnergySensitiveDetector::addback() {
-    size_t maximum_energy_deposition_index = 0;
+    const uint32_t hits = get_hit_mask();
 
-    for (size_t n_c_0 = 0; n_c_0 < channels.size(); ++n_c_0) {
-        if (!isnan(channels[n_c_0].energy_calibrated) && !skip_channel[n_c_0]) {
-            addback_energies[n_c_0] = channels[n_c_0].energy_calibrated;
-            addback_times[n_c_0] = channels[n_c_0].time_calibrated;
-            maximum_energy_deposition_index = n_c_0;
-
-            for (size_t n_c_1 = n_c_0 + 1; n_c_1 < channels.size(); ++n_c_1) {
-                if (!isnan(channels[n_c_1].energy_calibrated) &&
-                    !skip_channel[n_c_1] &&
-                    addback_coincidence_gates[n_c_0][n_c_1 - n_c_0 - 1](
-                        channels[n_c_0].time_calibrated -
-                        channels[n_c_1].time_calibrated)) {
-                    addback_energies[n_c_0] +=
-                        channels[n_c_1].energy_calibrated;
-                    skip_channel[n_c_1] = true;
-                    if (channels[n_c_1].energy_calibrated >
-
-                        channels[n_c_0].energy_calibrated) {
-                        maximum_energy_deposition_index = n_c_1;
-                    }
+    // With at most one hit, the addback is just a copy of the channel.
+    if ((hits & (hits - 1)) == 0) {
+        if (hits != 0) {
+            const size_t n_channel = __builtin_ctz(hits);
+            addback_energy = channels[n_channel].energy_calibrated();
+            addback_time = channels[n_channel].time_calibrated();
+            addback_time_vs_reference_time =
+                channels[n_channel].time_vs_reference_time_calibrated();
+        }
+        return;
+    }
+
+    uint32_t unassigned = hits;
+    uint32_t first_channels = 0;
+    while (unassigned != 0) {
+        const size_t n_c_0 = __builtin_ctz(unassigned);
+        unassigned &= unassigned - 1;
+        first_channels |= uint32_t(1) << n_c_0;
+
+        const double energy_0 = channels[n_c_0].energy_calibrated();
+        const double time_0 = channels[n_c_0].time_calibrated();
+        size_t maximum_energy_deposition_index = n_c_0;
+        addback_energies[n_c_0] = energy_0;
+
+        for (uint32_t candidates = unassigned; candidates != 0;
+             candidates &= candidates - 1) {
+            const size_t n_c_1 = __builtin_ctz(candidates);
+            if (addback_gate(n_c_0, n_c_1,
+                             time_0 - channels[n_c_1].time_calibrated())) {
+                addback_energies[n_c_0] += channels[n_c_1].energy_calibrated();
+                unassigned &= ~(uint32_t(1) << n_c_1);
+                if (channels[n_c_1].energy_calibrated() > energy_0) {
+                    maximum_energy_deposition_index = n_c_1;
                 }
             }
-            addback_times[n_c_0] =
-                channels[maximum_energy_deposition_index].time_calibrated;
-            skip_channel[n_c_0] = true;
         }
+        addback_times[n_c_0] =
+            channels[maximum_energy_deposition_index].time_calibrated();
     }
 
-    filter_addback();
+    filter_addback(first_channels);
 }
 
 double EnergySensitiveDetector::get_calibrated_and_RF_gated_energy() const {
     if (channels.size() > 1) {
         return addback_energy;
     }
-    return channels[0].energy_calibrated;
+    return channels[0].energy_calibrated();
 }
 
 void EnergySensitiveDetector::reset_calibrated_leaves() {
     for (size_t n_channel = 0; n_channel < channels.size(); ++n_channel) {
         channels[n_channel].reset_calibrated_leaves();
-        skip_channel[n_channel] = false;
-        addback_energies[n_channel] = numeric_limits<double>::quiet_NaN();
-        addback_times[n_channel] = numeric_limits<double>::quiet_NaN();
     }
 
+    reset_addback();
+}
+
+void EnergySensitiveDetector::reset_addback() {
     addback_energy = numeric_limits<double>::quiet_NaN();
     addback_time = numeric_limits<double>::quiet_NaN();
     addback_time_vs_reference_time = numeric_limits<double>::quiet_NaN();
@@ -163,16 +221,16 @@ void EnergySensitiveDetector::set_up_calibrated_branches_for_reading(
             (name + "_" + channels[n_channel].name + "_t_vs_RF").c_str(), 1);
         tree->SetBranchAddress(
             (name + "_" + channels[n_channel].name + "_e").c_str(),
-            &channels[n_channel].energy_calibrated);
+            &channels[n_channel].energy_calibrated());
         tree->SetBranchAddress(
             (name + "_" + channels[n_channel].name + "_t").c_str(),
-            &channels[n_channel].time_calibrated);
+            &channels[n_channel].time_calibrated());
         tree->SetBranchAddress(
             (name + "_" + channels[n_channel].name + "_ts").c_str(),
-            &channels[n_channel].timestamp_calibrated);
+            &channels[n_channel].timestamp_calibrated());
         tree->SetBranchAddress(
             (name + "_" + channels[n_channel].name + "_t_vs_RF").c_str(),
-            &channels[n_channel].time_vs_reference_time_calibrated);
+            &channels[n_channel].time_vs_reference_time_calibrated());
     }
 
     if (channels.size() > 1) {
@@ -193,14 +251,14 @@ void EnergySensitiveDetector::set_up_calibrated_branches_for_writing(
     TTree *tree) {
     for (size_t n_channel = 0; n_channel < channels.size(); ++n_channel) {
         tree->Branch((name + "_" + channels[n_channel].name + "_e").c_str(),
-                     &channels[n_channel].energy_calibrated);
+                     &channels[n_channel].energy_calibrated());
         tree->Branch((name + "_" + channels[n_channel].name + "_t").c_str(),
-                     &channels[n_channel].time_calibrated);
+                     &channels[n_channel].time_calibrated());
         tree->Branch((name + "_" + channels[n_channel].name + "_ts").c_str(),
-                     &channels[n_channel].timestamp_calibrated);
+                     &channels[n_channel].timestamp_calibrated());
         tree->Branch(
             (name + "_" + channels[n_channel].name + "_t_vs_RF").c_str(),
-            &channels[n_channel].time_vs_reference_time_calibrated);
+            &channels[n_channel].time_vs_reference_time_calibrated());
     }
 
     if (channels.size() > 1) {
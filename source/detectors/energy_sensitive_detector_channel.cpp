@@ -15,6 +15,10 @@
     carolina. If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <memory>
+
+using std::make_shared;
+
 #include "energy_sensitive_detector_channel.hpp"
 #include "polynomial.hpp"
 
@@ -26,14 +30,22 @@ EnergySensitiveDetectorChannel::EnergySensitiveDetectorChannel(
     : Channel(name, module, channel), energy_calibration(energy_calibration),
       time_calibration(time_calibration),
       time_vs_reference_time_gate(time_vs_reference_time_gate),
-      energy_calibrated(numeric_limits<double>::quiet_NaN()),
-      time_calibrated(numeric_limits<double>::quiet_NaN()),
-      timestamp_calibrated(numeric_limits<double>::quiet_NaN()),
-      time_vs_reference_time_calibrated(numeric_limits<double>::quiet_NaN()) {}
+      calibrated_channel_table(make_shared<CalibratedChannelTable>(1)),
+      calibrated_channel_index(0) {}
+
+void EnergySensitiveDetectorChannel::bind_calibrated_channel_table(
+    shared_ptr<CalibratedChannelTable> table, const size_t index) {
+    table->energy[index] = energy_calibrated();
+    table->time[index] = time_calibrated();
+    table->timestamp[index] = timestamp_calibrated();
+    table->time_vs_reference_time[index] = time_vs_reference_time_calibrated();
+    table->set_valid(index,
+                     calibrated_channel_table->is_valid(calibrated_channel_index));
+    table->mark_written(index);
+    calibrated_channel_table = table;
+    calibrated_channel_index = index;
+}
 
 void EnergySensitiveDetectorChannel::reset_calibrated_leaves() {
-    energy_calibrated = numeric_limits<double>::quiet_NaN();
-    time_calibrated = numeric_limits<double>::quiet_NaN();
-    timestamp_calibrated = numeric_limits<double>::quiet_NaN();
-    time_vs_reference_time_calibrated = numeric_limits<double>::quiet_NaN();
-}
\ No newline at end of file
+    calibrated_channel_table->reset(calibrated_channel_index);
+}
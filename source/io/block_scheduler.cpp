@@ -0,0 +1,62 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+using std::min;
+
+#include <atomic>
+
+using std::atomic;
+
+#include <thread>
+
+using std::thread;
+
+#include <vector>
+
+using std::vector;
+
+#include "block_scheduler.hpp"
+
+void process_blocks_in_parallel(
+    const size_t n_blocks, const unsigned int n_threads,
+    const function<void(const size_t n_block, const unsigned int n_thread)>
+        process_block) {
+    if (n_threads <= 1) {
+        for (size_t n_block = 0; n_block < n_blocks; ++n_block) {
+            process_block(n_block, 0);
+        }
+        return;
+    }
+
+    atomic<size_t> next_block{0};
+    vector<thread> workers;
+    for (unsigned int n_thread = 0;
+         n_thread < min((size_t)n_threads, n_blocks); ++n_thread) {
+        workers.push_back(thread([&next_block, n_blocks, &process_block,
+                                  n_thread]() {
+            for (size_t n_block = next_block++; n_block < n_blocks;
+                 n_block = next_block++) {
+                process_block(n_block, n_thread);
+            }
+        }));
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
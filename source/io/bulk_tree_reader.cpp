@@ -0,0 +1,127 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+using std::upper_bound;
+
+#include <cstring>
+
+using std::memcpy;
+
+#include <memory>
+
+using std::make_unique;
+
+#include <utility>
+
+using std::move;
+
+#include "TLeaf.h"
+#include "TObjArray.h"
+
+#include "bulk_tree_reader.hpp"
+
+void BulkTreeReader::get_entry(const long long entry) {
+    if (!bulk) {
+        tree->GetEntry(entry);
+        return;
+    }
+
+    const long long local_entry = tree->LoadTree(entry);
+    if (local_entry < 0) {
+        return;
+    }
+    // The branches of a TChain change when a new file is opened.
+    if (tree->GetTreeNumber() != tree_number) {
+        tree_number = tree->GetTreeNumber();
+        set_up_columns();
+    }
+
+    for (auto &column : columns) {
+        if (!column.bulk) {
+            column.branch->GetEntry(local_entry);
+            continue;
+        }
+        if (local_entry < column.first_entry ||
+            local_entry >= column.first_entry + column.n_entries) {
+            read_basket(column, local_entry);
+            if (!column.bulk) {
+                column.branch->GetEntry(local_entry);
+                continue;
+            }
+        }
+        memcpy(column.address,
+               column.data +
+                   (local_entry - column.first_entry) * column.entry_size,
+               column.entry_size);
+    }
+}
+
+void BulkTreeReader::set_up_columns() {
+    columns.clear();
+    TTree *current_tree = tree->GetTree();
+    TObjArray *branches = current_tree->GetListOfBranches();
+    for (int n_branch = 0; n_branch < branches->GetEntriesFast();
+         ++n_branch) {
+        TBranch *branch = static_cast<TBranch *>(branches->At(n_branch));
+        if (!current_tree->GetBranchStatus(branch->GetName()) ||
+            branch->GetAddress() == nullptr) {
+            continue;
+        }
+
+        Column column;
+        column.branch = branch;
+        column.address = branch->GetAddress();
+        column.entry_size = 0;
+        column.data = nullptr;
+        column.first_entry = 0;
+        column.n_entries = 0;
+        TObjArray *leaves = branch->GetListOfLeaves();
+        // Only branches with a single leaf of fixed size (a number or an
+        // array with a constant length) can be copied from a column.
+        column.bulk = branch->SupportsBulkRead() &&
+                      leaves->GetEntriesFast() == 1 &&
+                      static_cast<TLeaf *>(leaves->At(0))->GetLeafCount() ==
+                          nullptr;
+        if (column.bulk) {
+            const TLeaf *leaf = static_cast<TLeaf *>(leaves->At(0));
+            column.entry_size = leaf->GetLen() * leaf->GetLenType();
+            column.buffer = make_unique<TBufferFile>(TBuffer::kWrite);
+        }
+        columns.push_back(move(column));
+    }
+}
+
+void BulkTreeReader::read_basket(Column &column, const long long local_entry) {
+    // Bulk reads start at the first entry of a basket.
+    const Long64_t *basket_entry = column.branch->GetBasketEntry();
+    const Long64_t *basket = upper_bound(
+        basket_entry, basket_entry + column.branch->GetWriteBasket() + 1,
+        local_entry);
+    const long long first_entry = *(basket - 1);
+
+    const Int_t n_entries = column.branch->GetBulkRead().GetBulkEntries(
+        first_entry, *column.buffer);
+    if (n_entries <= 0 || local_entry >= first_entry + n_entries) {
+        column.bulk = false;
+        return;
+    }
+    column.data = column.buffer->GetCurrent();
+    column.first_entry = first_entry;
+    column.n_entries = n_entries;
+}
@@ -29,15 +29,38 @@ using std::vector;
 
 CommandLineParser::CommandLineParser() {
     desc.add_options()("help", "Produce help message.")(
+        "cache-mb", po::value<long long>()->default_value(-1),
+        "Size of the TTreeCache for reading input trees in MB. A value of 0 "
+        "disables the cache (default: -1, i.e. use the default size of "
+        "ROOT).")(
+        "event-window", po::value<long long>()->default_value(-1),
+        "Only for the 'mvlclst' reader: merge the data of different modules "
+        "into one event if their timestamps differ by at most this number of "
+        "clock ticks. A negative value disables the event building, i.e. each "
+        "module header starts a new event (default: -1). The event building "
+        "always reads the whole file, because entries are module frames, "
+        "not events. It cannot be combined with '--first', '--last', or "
+        "with the processing of several blocks of entries in parallel.")(
         "first", po::value<long long>()->default_value(0),
-        "First entry to be processed.")("input", po::value<vector<string>>(),
-                                        "Input file names.")(
+        "First entry to be processed. For the 'mvlclst' reader, each module "
+        "frame is one entry.")("input", po::value<vector<string>>(),
+                               "Input file names.")(
         "last", po::value<long long>()->default_value(-1),
         "Last entry to be processed.")(
+        "learn-entries", po::value<int>()->default_value(0),
+        "Number of entries that the TTreeCache uses to learn which branches "
+        "are read, in addition to the active branches (default: 0, i.e. only "
+        "cache the active branches).")(
         "list", "Indicates that the input file is a text file that contains a "
                 "list of ROOT files to read.")(
         "output", po::value<string>()->default_value("output.root"),
         "Output file name (default: 'output.root').")(
+        "prefetch", "Prefetch the input baskets asynchronously in a separate "
+                    "thread (default: no prefetching).")(
+        "reader-mode", po::value<string>()->default_value("entry"),
+        "How entries are read from a TTree. 'entry': read all branches entry "
+        "by entry. 'bulk': read each branch basket by basket into memory, and "
+        "take the entries from there (default: 'entry').")(
         "tree", po::value<string>()->default_value(""),
         "TTree name [default: \"\" (empty string), i.e. take the first TTree "
         "in the file]");
@@ -58,9 +81,19 @@ void CommandLineParser::operator()(int argc, char *argv[], int &status) {
     } else if (!vm.count("input")) {
         cout << "No input file given. Aborting ..." << endl;
         status = 1;
+    } else if (vm["reader-mode"].as<string>() != "entry" &&
+               vm["reader-mode"].as<string>() != "bulk") {
+        cout << "Unknown reader mode '" << vm["reader-mode"].as<string>()
+             << "'. Aborting ..." << endl;
+        status = 1;
     }
 }
 
+TreeCache CommandLineParser::get_tree_cache() const {
+    return TreeCache(vm["cache-mb"].as<long long>(),
+                     vm["learn-entries"].as<int>(), vm.count("prefetch"));
+}
+
 [[deprecated(
     "Will be replaced by a Reader class in a future version.")]] TChain *
 CommandLineParser::set_up_tree(long long &first, long long &last,
@@ -26,8 +26,11 @@ vector<double> Polynomial::parse_string(const string parameter_string) const {
 }
 
 double Polynomial::operator()(const double x) const {
-    double result = parameters[*parameters.end() - 1];
-    for (size_t i = parameters.size(); i > 0; --i) {
+    if (parameters.empty()) {
+        return 0.;
+    }
+    double result = parameters.back();
+    for (size_t i = parameters.size() - 1; i > 0; --i) {
         result = parameters[i - 1] + result * x;
     }
     return result;
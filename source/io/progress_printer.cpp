@@ -15,6 +15,10 @@
     carolina. If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <chrono>
+
+using std::chrono::duration;
+
 #include <ctime>
 
 using std::ctime;
@@ -39,7 +43,8 @@ ProgressPrinter::ProgressPrinter(const long long first, const long long last,
                                  const double update_increment,
                                  const string unit_singular,
                                  const string unit_plural)
-    : start_time(time(nullptr)), first(first), last(last),
+    : start_time(time(nullptr)), start_time_point(steady_clock::now()),
+      unit_plural(unit_plural), first(first), last(last),
       n_entries(last - first + 1), inverse_n_entries(1. / (double)n_entries),
       update_increment(update_increment), current_percentage(update_increment) {
     cout << get_time_string() << " : Starting to process " << n_entries << " ";
@@ -56,9 +61,16 @@ void ProgressPrinter::operator()(const long long index) {
 
     if (percentage >= current_percentage) {
         time_t current_time = time(nullptr);
+        const double elapsed_seconds =
+            duration<double>(steady_clock::now() - start_time_point).count();
+        const long long rate =
+            elapsed_seconds > 0.
+                ? (long long)((index - first + 1) / elapsed_seconds)
+                : 0;
         cout << get_time_string() << " : " << setw(5)
              << current_percentage * 100. << " % processed in " << setw(5)
-             << current_time - start_time << " second(s)." << endl;
+             << current_time - start_time << " second(s) (" << setw(9)
+             << rate << " " << unit_plural << "/s)." << endl;
 
         current_percentage =
             ((int)((percentage + update_increment) / update_increment)) *
@@ -0,0 +1,83 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include "TBranch.h"
+#include "TEnv.h"
+#include "TFile.h"
+#include "TObjArray.h"
+#include "TTreeCache.h"
+
+#include "tree_cache.hpp"
+
+TreeCache::TreeCache(const long long cache_mb, const int learn_entries,
+                     const bool prefetch)
+    : cache_mb(cache_mb), learn_entries(learn_entries), prefetch(prefetch) {
+    if (prefetch) {
+        gEnv->SetValue("TFile.AsyncPrefetching", 1);
+    }
+}
+
+void TreeCache::set_up(TTree *tree) const {
+    if (cache_mb >= 0) {
+        tree->SetCacheSize(cache_mb * 1024 * 1024);
+    }
+    if (cache_mb == 0) {
+        return;
+    }
+
+    // The cache belongs to a file. A TChain opens its first file only when an
+    // entry is loaded.
+    if (tree->GetCurrentFile() == nullptr) {
+        tree->LoadTree(0);
+    }
+    TObjArray *branches = tree->GetListOfBranches();
+    for (int n_branch = 0; n_branch < branches->GetEntriesFast();
+         ++n_branch) {
+        const char *branch_name = branches->At(n_branch)->GetName();
+        if (tree->GetBranchStatus(branch_name)) {
+            tree->AddBranchToCache(branch_name, true);
+        }
+    }
+    if (learn_entries > 0) {
+        tree->SetCacheLearnEntries(learn_entries);
+    } else {
+        tree->StopCacheLearningPhase();
+    }
+}
+
+void TreeCache::print_statistics(TTree *tree) const {
+    cout << "Read " << TFile::GetFileBytesRead()
+         << " bytes from input files in " << TFile::GetFileReadCalls()
+         << " read calls." << endl;
+    if (tree == nullptr || tree->GetCurrentFile() == nullptr) {
+        return;
+    }
+    const TTreeCache *cache = tree->GetReadCache(tree->GetCurrentFile());
+    if (cache == nullptr) {
+        cout << "No TTreeCache was used." << endl;
+        return;
+    }
+    cout << "TTreeCache of '" << tree->GetCurrentFile()->GetName()
+         << "': size " << cache->GetBufferSize() << " bytes, efficiency "
+         << cache->GetEfficiency() << ", relative efficiency "
+         << cache->GetEfficiencyRel() << "." << endl;
+}
@@ -17,11 +17,9 @@
 
 #include "digitizer_module.hpp"
 
-double DigitizerModule::get_amplitude(const size_t leaf) {
-    if (add_pseudorandom_number_to_integers) {
-        return get_raw_amplitude(leaf) + uniform_distribution(random_engine);
-    }
-    return get_raw_amplitude(leaf);
+double DigitizerModule::get_amplitude(const size_t leaf,
+                                      const long long n_entry) {
+    return dither(get_raw_amplitude(leaf), n_entry, leaf);
 }
 
 void DigitizerModule::reset_raw_leaves(const vector<bool> amp_t_tref_ts) {
@@ -41,6 +39,7 @@ void DigitizerModule::reset_raw_leaves(const vector<bool> amp_t_tref_ts) {
 
 void DigitizerModule::set_up_raw_branches_for_reading(
     TTree *tree, const vector<bool> amp_t_tref_ts) {
+    raw_leaves_read_from_tree = true;
     if (amp_t_tref_ts[0]) {
         set_up_raw_amplitude_branches_for_reading(tree);
     }
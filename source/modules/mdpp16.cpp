@@ -15,6 +15,10 @@
     carolina. If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+
+using std::min;
+
 #include <limits>
 
 using std::numeric_limits;
@@ -41,6 +45,12 @@ u_int32_t MDPP16::get_data_length(const u_int32_t word) {
     return word & data_length_mask;
 }
 
+bool MDPP16::get_header_format(HeaderFormat &header_format) const {
+    header_format = {header_mask, header_found_flag, module_id_mask,
+                     module_id_offset};
+    return true;
+}
+
 u_int32_t MDPP16::get_high_stamp(const u_int32_t word) {
     return word & high_stamp_mask;
 }
@@ -49,6 +59,93 @@ u_int32_t MDPP16::get_low_stamp(const u_int32_t word) {
     return word & low_stamp_mask;
 }
 
+// Same result as the timestamp leaf after process_event().
+bool MDPP16::get_timestamp(const u_int32_t *words, const size_t n_words,
+                           u_int64_t &timestamp) {
+    bool timestamp_found = false;
+    timestamp = 0;
+    for (size_t n_word = 0; n_word < n_words; ++n_word) {
+        if (data_found(words[n_word])) {
+            continue;
+        }
+        if (extended_ts_found(words[n_word])) {
+            timestamp +=
+                ((u_int64_t)get_high_stamp(words[n_word])) * high_stamp_offset;
+        } else if (eoe_found(words[n_word])) {
+            timestamp += get_low_stamp(words[n_word]);
+            timestamp_found = true;
+        }
+    }
+    return timestamp_found;
+}
+
+// Word classes for process_event().
+const uint8_t data_word_class = 1;
+const uint8_t extended_ts_word_class = 2;
+const uint8_t eoe_word_class = 4;
+
+bool MDPP16::process_event(const u_int32_t *words, const size_t n_words) {
+    bool end_of_event = false;
+    uint8_t word_class[batch_size];
+
+    // Data words are scattered without branches: the channel address selects
+    // one of the leaves below and an index inside the leaf.
+    // Addresses that are not used by the firmware go to a dummy leaf.
+    double ignored_leaf;
+    double *const leaves[4] = {amplitude.leaves, time.leaves,
+                               reference_time.leaves, &ignored_leaf};
+
+    for (size_t first_word = 0; first_word < n_words;
+         first_word += batch_size) {
+        const u_int32_t *batch = words + first_word;
+        const size_t n_batch = min(batch_size, n_words - first_word);
+
+        // Classify the words without branches, so that the compiler can
+        // vectorize this loop.
+        // For full batches, the loop has a constant trip count.
+        uint8_t all_data = data_word_class;
+        if (n_batch == batch_size) {
+            for (size_t n_word = 0; n_word < batch_size; ++n_word) {
+                word_class[n_word] =
+                    ((batch[n_word] & data_found_mask) == data_found_flag) |
+                    (((batch[n_word] & extended_ts_mask) == extended_ts_flag)
+                     << 1) |
+                    (((batch[n_word] & eoe_mask) == eoe_found_flag) << 2);
+                all_data &= word_class[n_word];
+            }
+        } else {
+            for (size_t n_word = 0; n_word < n_batch; ++n_word) {
+                word_class[n_word] =
+                    ((batch[n_word] & data_found_mask) == data_found_flag) |
+                    (((batch[n_word] & extended_ts_mask) == extended_ts_flag)
+                     << 1) |
+                    (((batch[n_word] & eoe_mask) == eoe_found_flag) << 2);
+                all_data &= word_class[n_word];
+            }
+        }
+
+        for (size_t n_word = 0; n_word < n_batch; ++n_word) {
+            if (all_data || word_class[n_word] & data_word_class) {
+                channel_address = (batch[n_word] & channel_address_mask) /
+                                  channel_address_offset;
+                leaves[(channel_address >= 16) + (channel_address >= 32) +
+                       (channel_address >= n_channel_addresses)]
+                      [(channel_address & 0xF) & -(channel_address < 32)] =
+                          batch[n_word] & data_mask;
+                written_leaves |= uint32_t(channel_address < 32)
+                                  << (channel_address & 0x1F);
+            } else if (word_class[n_word] & extended_ts_word_class) {
+                process_high_stamp(batch[n_word]);
+            } else if (word_class[n_word] & eoe_word_class) {
+                process_low_stamp(batch[n_word]);
+                end_of_event = true;
+            }
+        }
+    }
+
+    return end_of_event;
+}
+
 u_int32_t MDPP16::get_module_id(const u_int32_t word) {
     return (word & module_id_mask) / module_id_offset;
 }
@@ -58,14 +155,21 @@ bool MDPP16::header_found(const u_int32_t word) {
 }
 
 void MDPP16::reset_raw_amplitude_leaves() {
-    for (size_t n_leaf = 0; n_leaf < 16; ++n_leaf) {
-        amplitude.leaves[n_leaf] = numeric_limits<double>::quiet_NaN();
+    const uint32_t leaves =
+        raw_leaves_read_from_tree ? 0xFFFF : written_leaves & 0xFFFF;
+    for (uint32_t bits = leaves; bits != 0; bits &= bits - 1) {
+        amplitude.leaves[__builtin_ctz(bits)] =
+            numeric_limits<double>::quiet_NaN();
     }
+    written_leaves &= 0xFFFF0000;
 }
 void MDPP16::reset_raw_time_leaves() {
-    for (size_t n_leaf = 0; n_leaf < 16; ++n_leaf) {
-        time.leaves[n_leaf] = numeric_limits<double>::quiet_NaN();
+    const uint32_t leaves =
+        raw_leaves_read_from_tree ? 0xFFFF : written_leaves >> 16;
+    for (uint32_t bits = leaves; bits != 0; bits &= bits - 1) {
+        time.leaves[__builtin_ctz(bits)] = numeric_limits<double>::quiet_NaN();
     }
+    written_leaves &= 0x0000FFFF;
 }
 void MDPP16::reset_raw_reference_time_leaves() {
     reference_time.leaves[0] = numeric_limits<double>::quiet_NaN();
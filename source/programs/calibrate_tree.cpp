@@ -15,34 +15,108 @@
     carolina. If not, see <https://www.gnu.org/licenses/>.
 */
 
-#include <fstream>
-
-using std::ofstream;
-
 #include <iostream>
 
 using std::cout;
 using std::endl;
 
+#include <memory>
+
+using std::make_unique;
+using std::unique_ptr;
+
+#include <mutex>
+
+using std::lock_guard;
+using std::mutex;
+
 #include <string>
 
 using std::to_string;
 
-#include "TChain.h"
 #include "TFile.h"
-#include "TH1D.h"
+#include "TROOT.h"
 
+#include "block_scheduler.hpp"
+#include "calibrate_tree.hpp"
+#include "calibration_batch.hpp"
 #include "command_line_parser.hpp"
-#include "histograms_1d.hpp"
 #include "progress_printer.hpp"
 #include "tfile_utilities.hpp"
 
+void initialize_reader(Reader &reader, Analysis &analysis,
+                       const string tree_name) {
+    reader.initialize(analysis, tree_name, {true}, {true, true, true, true});
+}
+
+void fill_tree_from_batch(Analysis &analysis, CalibrationBatch &batch,
+                          TTree *tree_calibrated) {
+    analysis.calibrate_batch(batch);
+    for (size_t n_event = 0; n_event < batch.n_events; ++n_event) {
+        analysis.load_from_batch(batch, n_event);
+        if (tree_calibrated != nullptr) {
+            tree_calibrated->Fill();
+        }
+        analysis.reset_calibrated_leaves();
+    }
+    batch.clear();
+}
+
+// If tree_calibrated is a nullptr, the entries are only calibrated.
+// This is used to restore the state of the analysis (e.g. the previous counts
+// of the counter detectors) that the serial loop would have at the beginning
+// of a block.
+// The raw leaves are reset after each event, because a reader of listfiles
+// only sets the leaves of the channels that are present in the event.
+void calibrate_entries(Reader &reader, Analysis &analysis,
+                       const size_t batch_size, TTree *tree_calibrated,
+                       ProgressPrinter *progress_printer) {
+    unique_ptr<CalibrationBatch> batch;
+    if (batch_size > 1) {
+        batch = make_unique<CalibrationBatch>(analysis, batch_size);
+    }
+
+    unsigned int status;
+    while (reader.read(status, analysis)) {
+        if (status == 1) {
+            if (batch) {
+                analysis.add_to_batch(*batch, reader.entry);
+                if (batch->is_full()) {
+                    fill_tree_from_batch(analysis, *batch, tree_calibrated);
+                }
+            } else {
+                analysis.calibrate(reader.entry);
+                if (tree_calibrated != nullptr) {
+                    tree_calibrated->Fill();
+                }
+                analysis.reset_calibrated_leaves();
+            }
+            analysis.reset_raw_energy_sensitive_detector_leaves(
+                {true, true, true, true});
+        }
+        if (progress_printer != nullptr) {
+            (*progress_printer)(reader.entry);
+        }
+        status = 0;
+    }
+    if (batch) {
+        fill_tree_from_batch(analysis, *batch, tree_calibrated);
+    }
+}
+
 int main(int argc, char **argv) {
     CommandLineParser command_line_parser;
     command_line_parser.desc.add_options()(
         "block", po::value<long long>()->default_value(1000000),
         "Number of data entries that are processed before the data are written "
         "to file (default: 10^6).")(
+        "batch", po::value<size_t>()->default_value(1),
+        "Number of data entries that are calibrated together (default: 1, i.e. "
+        "calibrate entry by entry). Larger batches allow the calibrations to "
+        "be vectorized.")(
+        "jobs", po::value<unsigned int>()->default_value(1),
+        "Number of blocks that are processed in parallel. The output does "
+        "not depend on the number of jobs (default: 1).")(
         "log",
         "Create a text file ('log file') that contains the names of the "
         "generated "
@@ -55,55 +129,119 @@ int main(int argc, char **argv) {
     }
     const po::variables_map vm = command_line_parser.get_variables_map();
 
-    long long first, last;
-    TChain *t = command_line_parser.set_up_tree(first, last, vm.count("list"));
+    const vector<string> input_files =
+        vm.count("list") == 0
+            ? vm["input"].as<vector<string>>()
+            : read_log_file(vm["input"].as<vector<string>>()[0]);
+    const string tree_name = vm["tree"].as<string>();
+    const string reader_mode = vm["reader-mode"].as<string>();
+
+    // The reader is only used to determine the range of entries and the name
+    // of the output tree. Each block is read by its own reader.
+    Reader reader(input_files, vm["first"].as<long long>(),
+                  vm["last"].as<long long>(), reader_mode);
+    reader.tree_cache = command_line_parser.get_tree_cache();
+    reader.event_window = vm["event-window"].as<long long>();
+    initialize_reader(reader, analysis, tree_name);
+    const long long first = reader.first, last = reader.last;
+    const string tree_calibrated_name = reader.get_tree_name();
+    reader.finalize();
 
     vector<pair<long long, long long>> blocks =
         divide_into_blocks(first, last, vm["block"].as<long long>());
-    const string tree_calibrated_name = t->GetName();
+    if (blocks.size() > 1 && reader.event_window >= 0) {
+        cout << "Error: '--event-window' cannot be used with more than one "
+                "block. Increase '--block' to the number of entries. "
+                "Aborting ..."
+             << endl;
+        abort();
+    }
 
-    ProgressPrinter progress_printer(first, last);
     vector<string> output_file_names;
-
     for (size_t n_block = 0; n_block < blocks.size(); ++n_block) {
-        TChain *tree =
-            command_line_parser.set_up_tree(first, last, vm.count("list"));
-        tree->SetBranchStatus("*", 0);
-        analysis.set_up_raw_counter_detector_branches_for_reading(tree, {true});
-        analysis.set_up_raw_energy_sensitive_detector_branches_for_reading(
-            tree, {true, true, true, true});
-        TTree *tree_calibrated = new TTree(tree_calibrated_name.c_str(),
-                                           tree_calibrated_name.c_str());
-        analysis.set_up_calibrated_counter_detector_branches_for_writing(
-            tree_calibrated);
-        analysis
-            .set_up_calibrated_energy_sensitive_detector_branches_for_writing(
-                tree_calibrated);
-
-        for (long long i = blocks[n_block].first; i <= blocks[n_block].second;
-             ++i) {
-            tree->GetEntry(i);
-            analysis.calibrate(i);
-            tree_calibrated->Fill();
-            analysis.reset_calibrated_leaves();
-            progress_printer(i);
-        }
-
         output_file_names.push_back(remove_or_replace_suffix(
             vm["output"].as<string>(), "_" + to_string(n_block) + ".root"));
-        TFile output_file(output_file_names[n_block].c_str(), "RECREATE");
-        tree_calibrated->Write();
-        output_file.Close();
-        cout << "Wrote block [" << blocks[n_block].first << ", "
-             << blocks[n_block].second << "] to output file '"
-             << output_file_names[n_block] << "'." << endl;
-
-        delete tree_calibrated;
-        delete tree;
     }
+
+    // Thread 0 uses the global analysis object, all other threads work on a
+    // clone.
+    const unsigned int n_jobs = vm["jobs"].as<unsigned int>();
+    const size_t batch_size = vm["batch"].as<size_t>();
+    if (batch_size < 1) {
+        cout << "Error: '--batch' must be at least 1. Aborting ..." << endl;
+        abort();
+    }
+    if (n_jobs > 1) {
+        ROOT::EnableThreadSafety();
+    }
+    vector<Analysis> thread_analyses;
+    for (unsigned int n_thread = 1; n_thread < n_jobs; ++n_thread) {
+        thread_analyses.push_back(analysis.clone());
+    }
+
+    unique_ptr<ProgressPrinter> progress_printer;
+    if (n_jobs <= 1) {
+        progress_printer = make_unique<ProgressPrinter>(first, last);
+    }
+    mutex cout_mutex;
+
+    process_blocks_in_parallel(
+        blocks.size(), n_jobs,
+        [&](const size_t n_block, const unsigned int n_thread) {
+            Analysis &thread_analysis =
+                n_thread == 0 ? analysis : thread_analyses[n_thread - 1];
+
+            // A thread may process blocks that are not consecutive.
+            // Calibrate the entry before the block to restore the state that
+            // a serial loop would have (e.g. the previous counts of the
+            // counter detectors).
+            if (n_jobs > 1 && n_block > 0) {
+                Reader previous_entry_reader(input_files,
+                                             blocks[n_block].first - 1,
+                                             blocks[n_block].first - 1,
+                                             reader_mode);
+                previous_entry_reader.tree_cache = reader.tree_cache;
+                previous_entry_reader.event_window = reader.event_window;
+                initialize_reader(previous_entry_reader, thread_analysis,
+                                  tree_name);
+                calibrate_entries(previous_entry_reader, thread_analysis, 1,
+                                  nullptr, nullptr);
+                previous_entry_reader.finalize();
+            }
+
+            TFile output_file(output_file_names[n_block].c_str(), "RECREATE");
+            TTree *tree_calibrated = new TTree(tree_calibrated_name.c_str(),
+                                               tree_calibrated_name.c_str());
+            thread_analysis
+                .set_up_calibrated_counter_detector_branches_for_writing(
+                    tree_calibrated);
+            thread_analysis
+                .set_up_calibrated_energy_sensitive_detector_branches_for_writing(
+                    tree_calibrated);
+
+            Reader block_reader(input_files, blocks[n_block].first,
+                                blocks[n_block].second, reader_mode);
+            block_reader.tree_cache = reader.tree_cache;
+            block_reader.event_window = reader.event_window;
+            initialize_reader(block_reader, thread_analysis, tree_name);
+            calibrate_entries(block_reader, thread_analysis, batch_size,
+                              tree_calibrated, progress_printer.get());
+            block_reader.finalize();
+
+            tree_calibrated->Write();
+            output_file.Close();
+
+            lock_guard<mutex> lock(cout_mutex);
+            cout << "Wrote block [" << blocks[n_block].first << ", "
+                 << blocks[n_block].second << "] to output file '"
+                 << output_file_names[n_block] << "'." << endl;
+        });
+    progress_printer.reset();
+    reader.tree_cache.print_statistics();
+
     if (vm.count("log")) {
         write_list_of_output_files(
             remove_or_replace_suffix(vm["output"].as<string>(), ".log"),
             output_file_names);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,235 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Create several data products from raw data in a single pass.
+// Each entry is read and calibrated only once, and then passed to all
+// requested products. Each product is written to its own output file, whose
+// name is the output file name with the name of the product as a suffix.
+// The products are equivalent to the output of:
+//
+//  'calibrated': calibrate_tree
+//  '1d': histograms_1d
+//  '2d': histograms_2d
+//  'history': history
+//  'e_vs_t': energy_vs_time
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <memory>
+
+using std::make_unique;
+using std::unique_ptr;
+
+#include <set>
+
+using std::set;
+
+#include <sstream>
+
+using std::getline;
+using std::stringstream;
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TTree.h"
+
+#include "carolina_run.hpp"
+#include "coincidence_matrix_set.hpp"
+#include "command_line_parser.hpp"
+#include "energy_vs_time_set.hpp"
+#include "histogram_set_1d.hpp"
+#include "history_set.hpp"
+#include "memory_usage.hpp"
+#include "progress_printer.hpp"
+#include "tfile_utilities.hpp"
+
+const set<string> available_products = {"calibrated", "1d", "2d", "history",
+                                        "e_vs_t"};
+
+set<string> parse_products(const string product_list) {
+    set<string> products;
+    stringstream stream(product_list);
+    string product;
+    while (getline(stream, product, ',')) {
+        if (!available_products.count(product)) {
+            cout << "Error: unknown product '" << product << "'. Aborting ..."
+                 << endl;
+            abort();
+        }
+        products.insert(product);
+    }
+    return products;
+}
+
+int main(int argc, char **argv) {
+    CommandLineParser command_line_parser;
+    command_line_parser.desc.add_options()(
+        "dense", "Write the coincidence matrices of the '2d' product as TH2I "
+                 "instead of THnSparseI (see 'histograms_2d').")(
+        "products",
+        po::value<string>()->default_value("calibrated,1d,2d,history,e_vs_t"),
+        "Comma-separated list of the products that are created from the raw "
+        "data. 'calibrated': calibrated tree, '1d': histograms, '2d': "
+        "coincidence matrices, 'history': histograms vs. entry number, "
+        "'e_vs_t': energy-vs-time histograms (default: all). The output file "
+        "of a product is the output file name with the suffix "
+        "'_<product>.root'.")(
+        "rebin_time", po::value<unsigned int>()->default_value(1),
+        "Reduce the number of bins in time histograms of the 'e_vs_t' product "
+        "by this factor (default: 1, i.e. no reduction).")(
+        "rebin_energy", po::value<unsigned int>()->default_value(16),
+        "Reduce the number of bins in energy histograms of the 'e_vs_t' "
+        "product by this factor (default: 16, i.e. compress 16 bins into 1).")(
+        "tdiff-pairs", po::value<string>()->default_value("all"),
+        "Pairs of channels for which time-difference histograms are created "
+        "in the '1d' product (see 'histograms_1d', default: 'all').");
+    int command_line_parser_status;
+    command_line_parser(argc, argv, command_line_parser_status);
+    if (command_line_parser_status) {
+        return 0;
+    }
+    const po::variables_map vm = command_line_parser.get_variables_map();
+
+    const set<string> products = parse_products(vm["products"].as<string>());
+    const string output = vm["output"].as<string>();
+    const vector<string> input_files =
+        vm.count("list") == 0
+            ? vm["input"].as<vector<string>>()
+            : read_log_file(vm["input"].as<vector<string>>()[0]);
+
+    TH1::AddDirectory(false);
+
+    Reader reader(input_files, vm["first"].as<long long>(),
+                  vm["last"].as<long long>(), vm["reader-mode"].as<string>());
+    reader.tree_cache = command_line_parser.get_tree_cache();
+    reader.event_window = vm["event-window"].as<long long>();
+    reader.initialize(analysis, vm["tree"].as<string>(), {true},
+                      {true, true, true, true});
+
+    // The calibrated tree is filled entry by entry, so its file has to be open
+    // during the whole loop. All other products are only written at the end.
+    vector<string> output_file_names;
+    unique_ptr<TFile> calibrated_file;
+    TTree *calibrated_tree = nullptr;
+    if (products.count("calibrated")) {
+        output_file_names.push_back(
+            remove_or_replace_suffix(output, "_calibrated.root"));
+        calibrated_file = make_unique<TFile>(output_file_names.back().c_str(),
+                                             "RECREATE");
+        // Like in the output of 'calibrate_tree'.
+        const string tree_name = reader.get_tree_name();
+        calibrated_tree = new TTree(tree_name.c_str(), tree_name.c_str());
+        analysis.set_up_calibrated_counter_detector_branches_for_writing(
+            calibrated_tree);
+        analysis
+            .set_up_calibrated_energy_sensitive_detector_branches_for_writing(
+                calibrated_tree);
+    }
+    unique_ptr<HistogramSet1D> histograms_1d;
+    if (products.count("1d")) {
+        histograms_1d = make_unique<HistogramSet1D>(
+            analysis,
+            TimeDifferencePairSelection(vm["tdiff-pairs"].as<string>()));
+    }
+    unique_ptr<CoincidenceMatrixSet> histograms_2d;
+    if (products.count("2d")) {
+        histograms_2d = make_unique<CoincidenceMatrixSet>(analysis);
+    }
+    unique_ptr<HistorySet> history_histograms;
+    if (products.count("history")) {
+        history_histograms =
+            make_unique<HistorySet>(analysis, reader.first, reader.last);
+    }
+    unique_ptr<EnergyVsTimeSet> energy_vs_time_histograms;
+    if (products.count("e_vs_t")) {
+        energy_vs_time_histograms = make_unique<EnergyVsTimeSet>(
+            analysis, vm["rebin_energy"].as<unsigned int>(),
+            vm["rebin_time"].as<unsigned int>());
+    }
+
+    ProgressPrinter progress_printer(reader.first, reader.last);
+    unsigned int status;
+    while (reader.read(status, analysis)) {
+        analysis.calibrate(reader.entry);
+        if (status == 1) {
+            if (calibrated_tree != nullptr) {
+                calibrated_tree->Fill();
+            }
+            if (histograms_1d) {
+                histograms_1d->fill(analysis);
+            }
+            if (histograms_2d) {
+                histograms_2d->fill(analysis);
+            }
+            if (history_histograms) {
+                history_histograms->fill(analysis, reader.entry);
+            }
+            if (energy_vs_time_histograms) {
+                energy_vs_time_histograms->fill(analysis);
+            }
+            analysis.reset_raw_energy_sensitive_detector_leaves(
+                {true, true, true, false});
+            analysis.reset_calibrated_leaves();
+        }
+        progress_printer(reader.entry);
+        status = 0;
+    }
+    reader.print_statistics();
+    reader.finalize();
+
+    if (calibrated_file) {
+        calibrated_file->cd();
+        calibrated_tree->Write();
+        calibrated_file->Close();
+    }
+    if (histograms_1d) {
+        output_file_names.push_back(
+            remove_or_replace_suffix(output, "_1d.root"));
+        TFile output_file(output_file_names.back().c_str(), "RECREATE");
+        histograms_1d->write(analysis, output_file);
+        output_file.Close();
+    }
+    if (histograms_2d) {
+        output_file_names.push_back(
+            remove_or_replace_suffix(output, "_2d.root"));
+        TFile output_file(output_file_names.back().c_str(), "RECREATE");
+        histograms_2d->write(!vm.count("dense"));
+        output_file.Close();
+    }
+    if (history_histograms) {
+        output_file_names.push_back(
+            remove_or_replace_suffix(output, "_history.root"));
+        TFile output_file(output_file_names.back().c_str(), "RECREATE");
+        history_histograms->write();
+        output_file.Close();
+    }
+    if (energy_vs_time_histograms) {
+        output_file_names.push_back(
+            remove_or_replace_suffix(output, "_e_vs_t.root"));
+        TFile output_file(output_file_names.back().c_str(), "RECREATE");
+        energy_vs_time_histograms->write();
+        output_file.Close();
+    }
+
+    for (const auto &output_file_name : output_file_names) {
+        cout << "Created output file '" << output_file_name << "'." << endl;
+    }
+    print_peak_resident_set_size();
+}
@@ -26,12 +26,11 @@ using std::dynamic_pointer_cast;
 
 #include "TChain.h"
 #include "TFile.h"
-#include "TH2D.h"
 
+#include "bulk_tree_reader.hpp"
 #include "command_line_parser.hpp"
-#include "energy_sensitive_detector.hpp"
-#include "energy_sensitive_detector_channel.hpp"
 #include "energy_vs_time.hpp"
+#include "energy_vs_time_set.hpp"
 #include "progress_printer.hpp"
 #include "tfile_utilities.hpp"
 
@@ -51,6 +50,7 @@ int main(int argc, char **argv) {
     }
     const po::variables_map vm = command_line_parser.get_variables_map();
 
+    const TreeCache tree_cache = command_line_parser.get_tree_cache();
     long long first, last;
     TChain *tree =
         command_line_parser.set_up_tree(first, last, vm.count("list"));
@@ -61,104 +61,24 @@ int main(int argc, char **argv) {
     analysis.set_up_calibrated_counter_detector_branches_for_reading(tree);
     analysis.set_up_calibrated_energy_sensitive_detector_branches_for_reading(
         tree);
+    tree_cache.set_up(tree);
+    BulkTreeReader tree_reader(tree, vm["reader-mode"].as<string>() == "bulk");
 
-    vector<vector<TH2D *>> energy_vs_time_histograms;
-    string histogram_name;
-
-    for (size_t n_detector = 0;
-         n_detector < analysis.energy_sensitive_detectors.size();
-         ++n_detector) {
-        energy_vs_time_histograms.push_back(vector<TH2D *>());
-        for (auto channel :
-             analysis.energy_sensitive_detectors[n_detector]->channels) {
-            histogram_name =
-                analysis.energy_sensitive_detectors[n_detector]->name + "_" +
-                channel.name;
-            energy_vs_time_histograms[n_detector].push_back(new TH2D(
-                histogram_name.c_str(), histogram_name.c_str(),
-                analysis.energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector]
-                                  ->group]]
-                            ->histogram_properties.n_bins /
-                    vm["rebin_energy"].as<unsigned int>(),
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector]
-                                  ->group]]
-                    ->histogram_properties.lower_edge_of_first_bin,
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector]
-                                  ->group]]
-                    ->histogram_properties.upper_edge_of_last_bin,
-                analysis.energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector]
-                                  ->group]]
-                            ->time_histogram_properties.n_bins /
-                    vm["rebin_time"].as<unsigned int>(),
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector]
-                                  ->group]]
-                    ->time_histogram_properties.n_bins,
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector]
-                                  ->group]]
-                    ->time_histogram_properties.n_bins));
-        }
-    }
+    EnergyVsTimeSet energy_vs_time_histograms(
+        analysis, vm["rebin_energy"].as<unsigned int>(),
+        vm["rebin_time"].as<unsigned int>());
 
     for (long long i = first; i <= last; ++i) {
-        tree->GetEntry(i);
-
-        for (size_t n_detector = 0;
-             n_detector < analysis.energy_sensitive_detectors.size();
-             ++n_detector) {
-            for (size_t n_channel = 0;
-                 n_channel < analysis.energy_sensitive_detectors[n_detector]
-                                 ->channels.size();
-                 ++n_channel) {
-                if (!isnan(analysis.energy_sensitive_detectors[n_detector]
-                               ->channels[n_channel]
-                               .energy_calibrated) &&
-                    analysis.energy_sensitive_detectors[n_detector]
-                        ->channels[n_channel]
-                        .time_vs_reference_time_gate(
-                            analysis.energy_sensitive_detectors[n_detector]
-                                ->channels[n_channel]
-                                .time_vs_reference_time_calibrated)) {
-                    energy_vs_time_histograms[n_detector][n_channel]->Fill(
-                        analysis.energy_sensitive_detectors[n_detector]
-                            ->channels[n_channel]
-                            .energy_calibrated,
-                        analysis.energy_sensitive_detectors[n_detector]
-                            ->channels[n_channel]
-                            .time_calibrated);
-                }
-            }
-        }
+        tree_reader.get_entry(i);
+        energy_vs_time_histograms.fill(analysis);
         progress_printer(i);
     }
 
+    tree_cache.print_statistics(tree);
+
     TFile output_file(vm["output"].as<string>().c_str(), "RECREATE");
 
-    for (size_t n_detector = 0;
-         n_detector < analysis.energy_sensitive_detectors.size();
-         ++n_detector) {
-        for (size_t n_channel = 0;
-             n_channel <
-             analysis.energy_sensitive_detectors[n_detector]->channels.size();
-             ++n_channel) {
-            energy_vs_time_histograms[n_detector][n_channel]->Write();
-        }
-    }
+    energy_vs_time_histograms.write();
 
     output_file.Close();
     cout << "Created output file '" << vm["output"].as<string>() << "'."
@@ -15,40 +15,146 @@
     carolina. If not, see <https://www.gnu.org/licenses/>.
 */
 
-#include <algorithm>
-
-using std::max;
-using std::min;
-
-#include <cmath>
+#include <iostream>
 
-using std::isnan;
+using std::cout;
+using std::endl;
 
 #include <memory>
 
-using std::dynamic_pointer_cast;
+using std::make_unique;
+using std::unique_ptr;
 
-#include <iostream>
+#include <mutex>
 
-using std::cout;
-using std::endl;
+using std::lock_guard;
+using std::mutex;
 
-#include "TChain.h"
 #include "TFile.h"
-#include "TH1D.h"
+#include "TH1.h"
+#include "TROOT.h"
 
+#include "block_scheduler.hpp"
+#include "calibration_batch.hpp"
 #include "command_line_parser.hpp"
+#include "histogram_set_1d.hpp"
 #include "histograms_1d.hpp"
+#include "memory_usage.hpp"
+#include "pipeline.hpp"
 #include "progress_printer.hpp"
 #include "tfile_utilities.hpp"
 
+void initialize_reader(Reader &reader, Analysis &analysis,
+                       const string tree_name, const bool calibrate) {
+    if (calibrate) {
+        reader.initialize(analysis, tree_name, {true},
+                          {true, true, true, true});
+    } else {
+        reader.initialize(analysis, tree_name);
+        reader.set_up_calibrated_branches_for_reading(analysis);
+    }
+}
+
+void fill_histograms_from_calibrated_batch(Analysis &analysis,
+                                           const CalibrationBatch &batch,
+                                           HistogramSet1D *histograms) {
+    for (size_t n_event = 0; n_event < batch.n_events; ++n_event) {
+        analysis.load_from_batch(batch, n_event);
+        if (histograms != nullptr) {
+            histograms->fill(analysis);
+        }
+        analysis.reset_calibrated_leaves();
+    }
+}
+
+void fill_histograms_from_batch(Analysis &analysis, CalibrationBatch &batch,
+                                HistogramSet1D *histograms) {
+    analysis.calibrate_batch(batch);
+    fill_histograms_from_calibrated_batch(analysis, batch, histograms);
+    batch.clear();
+}
+
+// If histograms is a nullptr, the entries are only calibrated.
+// This is used to restore the state of the analysis (e.g. the previous counts
+// of the counter detectors) that the serial loop would have at the beginning
+// of a block.
+// If calibrate is set and batch_size is larger than 1, the entries are
+// calibrated in batches of batch_size events.
+void fill_histograms(Reader &reader, Analysis &analysis, const bool calibrate,
+                     const size_t batch_size, HistogramSet1D *histograms,
+                     ProgressPrinter *progress_printer) {
+    unique_ptr<CalibrationBatch> batch;
+    if (calibrate && batch_size > 1) {
+        batch = make_unique<CalibrationBatch>(analysis, batch_size);
+    }
+
+    unsigned int status;
+    while (reader.read(status, analysis)) {
+        if (batch) {
+            if (status == 1) {
+                analysis.add_to_batch(*batch, reader.entry);
+                analysis.reset_raw_energy_sensitive_detector_leaves(
+                    {true, true, true, false});
+                if (batch->is_full()) {
+                    fill_histograms_from_batch(analysis, *batch, histograms);
+                }
+            }
+        } else {
+            if (calibrate) {
+                analysis.calibrate(reader.entry);
+            } else {
+                analysis.update_valid_channels();
+            }
+
+            if (status == 1) {
+                if (histograms != nullptr) {
+                    histograms->fill(analysis);
+                }
+                if (calibrate) {
+                    analysis.reset_raw_energy_sensitive_detector_leaves(
+                        {true, true, true, false});
+                    analysis.reset_calibrated_leaves();
+                }
+            }
+        }
+        if (progress_printer != nullptr) {
+            (*progress_printer)(reader.entry);
+        }
+        status = 0;
+    }
+    if (batch) {
+        fill_histograms_from_batch(analysis, *batch, histograms);
+    }
+}
+
 int main(int argc, char **argv) {
     CommandLineParser command_line_parser;
     command_line_parser.desc.add_options()(
         "calibrate", "Assume that the input file contains raw data that need "
                      "to be calibrated by 'histograms_1d'."
                      "The default assumption is that the input file is "
-                     "output of the 'calibrate_tree' script.");
+                     "output of the 'calibrate_tree' script.")(
+        "batch", po::value<size_t>()->default_value(1),
+        "Number of entries that are calibrated together if '--calibrate' is "
+        "given (default: 1, i.e. calibrate entry by entry). Larger batches "
+        "allow the calibrations to be vectorized.")(
+        "pipeline",
+        "Read, calibrate, and fill the histograms in three threads that pass "
+        "batches of '--batch' entries to each other. Requires '--calibrate' "
+        "and cannot be combined with '--threads' (default: process each "
+        "batch completely before reading the next one).")(
+        "threads", po::value<unsigned int>()->default_value(1),
+        "Number of threads. The range of entries is divided into one block "
+        "per thread, each thread fills its own set of histograms, and the "
+        "sets are added after all blocks have been processed (default: 1).")(
+        "tdiff-pairs", po::value<string>()->default_value("all"),
+        "Pairs of channels for which time-difference histograms are created. "
+        "'all': all pairs, 'detector': pairs of channels of the same detector, "
+        "'group': pairs of channels of detectors in the same group. Any other "
+        "value is interpreted as the name of a text file with one pair per "
+        "line, given as two channel names '<detector>_<channel>' (default: "
+        "'all'). In any case, histograms are only created for pairs that "
+        "actually occur in the data.");
     int command_line_parser_status;
     command_line_parser(argc, argv, command_line_parser_status);
     if (command_line_parser_status) {
@@ -56,483 +162,139 @@ int main(int argc, char **argv) {
     }
     po::variables_map vm = command_line_parser.get_variables_map();
 
-    Reader reader(vm.count("list") == 0
-                      ? vm["input"].as<vector<string>>()
-                      : read_log_file(vm["input"].as<vector<string>>()[0]),
-                  vm["first"].as<long long>(), vm["last"].as<long long>());
-    reader.initialize(analysis, vm["tree"].as<string>(), {true},
-                      {true, false, false, false});
-    ProgressPrinter progress_printer(reader.first, reader.last);
-
-    vector<TH1D *> addback_histograms;
-    vector<vector<TH1D *>> energy_sensitive_detector_histograms;
-    vector<vector<TH1D *>> counter_detector_histograms;
-    vector<vector<TH1D *>> time_vs_reference_time_histograms;
-    vector<vector<vector<vector<TH1D *>>>> time_difference_histograms;
-    vector<TDirectory *> time_difference_directories;
-    string histogram_name;
-
-    for (size_t n_detector_1 = 0;
-         n_detector_1 < analysis.energy_sensitive_detectors.size();
-         ++n_detector_1) {
-        if (analysis.energy_sensitive_detectors[n_detector_1]->channels.size() >
-            1) {
-            histogram_name =
-                analysis.energy_sensitive_detectors[n_detector_1]->name +
-                "_addback";
-            addback_histograms.push_back(new TH1D(
-                histogram_name.c_str(), histogram_name.c_str(),
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector_1]
-                                  ->group]]
-                    ->histogram_properties.n_bins,
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector_1]
-                                  ->group]]
-                    ->histogram_properties.lower_edge_of_first_bin,
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector_1]
-                                  ->group]]
-                    ->histogram_properties.upper_edge_of_last_bin));
-        } else {
-            addback_histograms.push_back(nullptr);
-        }
-        energy_sensitive_detector_histograms.push_back(vector<TH1D *>());
-        time_difference_histograms.push_back(vector<vector<vector<TH1D *>>>());
-        time_vs_reference_time_histograms.push_back(vector<TH1D *>());
-        for (size_t n_channel_1 = 0;
-             n_channel_1 <
-             analysis.energy_sensitive_detectors[n_detector_1]->channels.size();
-             ++n_channel_1) {
-            time_difference_histograms[n_detector_1].push_back(
-                vector<vector<TH1D *>>());
-            histogram_name =
-                analysis.energy_sensitive_detectors[n_detector_1]->name + "_" +
-                analysis.energy_sensitive_detectors[n_detector_1]
-                    ->channels[n_channel_1]
-                    .name;
-            energy_sensitive_detector_histograms[n_detector_1].push_back(
-                new TH1D(
-                    histogram_name.c_str(), histogram_name.c_str(),
-                    analysis
-                        .energy_sensitive_detector_groups
-                            [analysis.group_index
-                                 [analysis
-                                      .energy_sensitive_detectors[n_detector_1]
-                                      ->group]]
-                        ->histogram_properties.n_bins,
-                    analysis
-                        .energy_sensitive_detector_groups
-                            [analysis.group_index
-                                 [analysis
-                                      .energy_sensitive_detectors[n_detector_1]
-                                      ->group]]
-                        ->histogram_properties.lower_edge_of_first_bin,
-                    analysis
-                        .energy_sensitive_detector_groups
-                            [analysis.group_index
-                                 [analysis
-                                      .energy_sensitive_detectors[n_detector_1]
-                                      ->group]]
-                        ->histogram_properties.upper_edge_of_last_bin));
-            histogram_name =
-                analysis.energy_sensitive_detectors[n_detector_1]->name + "_" +
-                analysis.energy_sensitive_detectors[n_detector_1]
-                    ->channels[n_channel_1]
-                    .name +
-                "_t_vs_RF";
-            time_vs_reference_time_histograms[n_detector_1].push_back(new TH1D(
-                histogram_name.c_str(), histogram_name.c_str(),
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector_1]
-                                  ->group]]
-                    ->time_histogram_properties.n_bins,
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector_1]
-                                  ->group]]
-                    ->time_histogram_properties.lower_edge_of_first_bin,
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector_1]
-                                  ->group]]
-                    ->time_histogram_properties.upper_edge_of_last_bin));
-
-            time_difference_histograms[n_detector_1][n_channel_1].push_back(
-                vector<TH1D *>());
-            for (size_t n_channel_2 = n_channel_1 + 1;
-                 n_channel_2 <
-                 analysis.energy_sensitive_detectors[n_detector_1]
-                     ->channels.size();
-                 ++n_channel_2) {
-                histogram_name =
-                    analysis.energy_sensitive_detectors[n_detector_1]->name +
-                    "_" +
-                    analysis.energy_sensitive_detectors[n_detector_1]
-                        ->channels[n_channel_1]
-                        .name +
-                    "_" +
-                    analysis.energy_sensitive_detectors[n_detector_1]->name +
-                    "_" +
-                    analysis.energy_sensitive_detectors[n_detector_1]
-                        ->channels[n_channel_2]
-                        .name +
-                    "_tdiff";
-                time_difference_histograms[n_detector_1][n_channel_1][0]
-                    .push_back(new TH1D(
-                        histogram_name.c_str(), histogram_name.c_str(),
-                        analysis
-                            .energy_sensitive_detector_groups
-                                [analysis.group_index
-                                     [analysis
-                                          .energy_sensitive_detectors
-                                              [n_detector_1]
-                                          ->group]]
-                            ->time_histogram_properties.n_bins,
-                        analysis
-                            .energy_sensitive_detector_groups
-                                [analysis.group_index
-                                     [analysis
-                                          .energy_sensitive_detectors
-                                              [n_detector_1]
-                                          ->group]]
-                            ->time_histogram_properties.lower_edge_of_first_bin,
-                        analysis
-                            .energy_sensitive_detector_groups
-                                [analysis.group_index
-                                     [analysis
-                                          .energy_sensitive_detectors
-                                              [n_detector_1]
-                                          ->group]]
-                            ->time_histogram_properties
-                            .upper_edge_of_last_bin));
-            }
+    const bool calibrate = vm.count("calibrate");
+    const size_t batch_size = vm["batch"].as<size_t>();
+    if (batch_size < 1) {
+        cout << "Error: '--batch' must be at least 1. Aborting ..." << endl;
+        abort();
+    }
+    const unsigned int n_threads = vm["threads"].as<unsigned int>();
+    const bool pipeline = vm.count("pipeline");
+    const string tree_name = vm["tree"].as<string>();
+    const string reader_mode = vm["reader-mode"].as<string>();
+    const TimeDifferencePairSelection time_difference_pairs(
+        vm["tdiff-pairs"].as<string>());
+    const vector<string> input_files =
+        vm.count("list") == 0
+            ? vm["input"].as<vector<string>>()
+            : read_log_file(vm["input"].as<vector<string>>()[0]);
 
-            for (size_t n_detector_2 = n_detector_1 + 1;
-                 n_detector_2 < analysis.energy_sensitive_detectors.size();
-                 ++n_detector_2) {
-                time_difference_histograms[n_detector_1][n_channel_1].push_back(
-                    vector<TH1D *>());
-                for (size_t n_channel_2 = 0;
-                     n_channel_2 <
-                     analysis.energy_sensitive_detectors[n_detector_2]
-                         ->channels.size();
-                     ++n_channel_2) {
-                    histogram_name =
-                        analysis.energy_sensitive_detectors[n_detector_1]
-                            ->name +
-                        "_" +
-                        analysis.energy_sensitive_detectors[n_detector_1]
-                            ->channels[n_channel_1]
-                            .name +
-                        "_" +
-                        analysis.energy_sensitive_detectors[n_detector_2]
-                            ->name +
-                        "_" +
-                        analysis.energy_sensitive_detectors[n_detector_2]
-                            ->channels[n_channel_2]
-                            .name +
-                        "_tdiff";
-                    time_difference_histograms
-                        [n_detector_1][n_channel_1][n_detector_2 - n_detector_1]
-                            .push_back(new TH1D(
-                                histogram_name.c_str(), histogram_name.c_str(),
-                                max(analysis
-                                        .energy_sensitive_detector_groups
-                                            [analysis.group_index
-                                                 [analysis
-                                                      .energy_sensitive_detectors
-                                                          [n_detector_1]
-                                                      ->group]]
-                                        ->time_histogram_properties.n_bins,
-                                    analysis
-                                        .energy_sensitive_detector_groups
-                                            [analysis.group_index
-                                                 [analysis
-                                                      .energy_sensitive_detectors
-                                                          [n_detector_2]
-                                                      ->group]]
-                                        ->time_histogram_properties.n_bins),
-                                min(analysis
-                                        .energy_sensitive_detector_groups
-                                            [analysis.group_index
-                                                 [analysis
-                                                      .energy_sensitive_detectors
-                                                          [n_detector_1]
-                                                      ->group]]
-                                        ->time_histogram_properties
-                                        .lower_edge_of_first_bin,
-                                    analysis
-                                        .energy_sensitive_detector_groups
-                                            [analysis.group_index
-                                                 [analysis
-                                                      .energy_sensitive_detectors
-                                                          [n_detector_2]
-                                                      ->group]]
-                                        ->time_histogram_properties
-                                        .lower_edge_of_first_bin),
-                                max(analysis
-                                        .energy_sensitive_detector_groups
-                                            [analysis.group_index
-                                                 [analysis
-                                                      .energy_sensitive_detectors
-                                                          [n_detector_1]
-                                                      ->group]]
-                                        ->time_histogram_properties
-                                        .upper_edge_of_last_bin,
-                                    analysis
-                                        .energy_sensitive_detector_groups
-                                            [analysis.group_index
-                                                 [analysis
-                                                      .energy_sensitive_detectors
-                                                          [n_detector_2]
-                                                      ->group]]
-                                        ->time_histogram_properties
-                                        .upper_edge_of_last_bin)));
-                }
-            }
-        }
+    if (pipeline && (!calibrate || n_threads > 1)) {
+        cout << "Error: '--pipeline' requires '--calibrate' and cannot be "
+                "combined with '--threads'. Aborting ..."
+             << endl;
+        abort();
     }
-    for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
-         ++n_detector) {
-        counter_detector_histograms.push_back(vector<TH1D *>());
-        for (auto channel : analysis.counter_detectors[n_detector]->channels) {
-            histogram_name = analysis.counter_detectors[n_detector]->name +
-                             "_" + channel.name;
-            counter_detector_histograms[n_detector].push_back(new TH1D(
-                histogram_name.c_str(), histogram_name.c_str(),
-                analysis
-                    .counter_detector_groups
-                        [analysis.group_index
-                             [analysis.counter_detectors[n_detector]->group]]
-                    ->histogram_properties.n_bins,
-                analysis
-                    .counter_detector_groups
-                        [analysis.group_index
-                             [analysis.counter_detectors[n_detector]->group]]
-                    ->histogram_properties.lower_edge_of_first_bin,
-                analysis
-                    .counter_detector_groups
-                        [analysis.group_index
-                             [analysis.counter_detectors[n_detector]->group]]
-                    ->histogram_properties.upper_edge_of_last_bin));
-        }
+    if (n_threads > 1 || pipeline) {
+        ROOT::EnableThreadSafety();
     }
+    TH1::AddDirectory(false);
 
-    unsigned int status;
-    while(reader.read(status, analysis)) {
-        if (vm.count("calibrate")) {
-            analysis.calibrate(reader.entry);
-        }
+    Reader reader(input_files, vm["first"].as<long long>(),
+                  vm["last"].as<long long>(), reader_mode);
+    reader.tree_cache = command_line_parser.get_tree_cache();
+    reader.event_window = vm["event-window"].as<long long>();
+    initialize_reader(reader, analysis, tree_name, calibrate);
+    if (n_threads > 1 && reader.event_window >= 0) {
+        cout << "Error: '--event-window' cannot be combined with '--threads'. "
+                "Aborting ..."
+             << endl;
+        abort();
+    }
 
-        if(status == 1){
-            for (size_t n_detector_1 = 0;
-                n_detector_1 < analysis.energy_sensitive_detectors.size();
-                ++n_detector_1) {
-                for (size_t n_channel_1 = 0;
-                    n_channel_1 <
-                    analysis.energy_sensitive_detectors[n_detector_1]
-                        ->channels.size();
-                    ++n_channel_1) {
-                    if (!isnan(analysis.energy_sensitive_detectors[n_detector_1]
-                                ->channels[n_channel_1]
-                                .energy_calibrated) &&
-                        analysis.energy_sensitive_detectors[n_detector_1]
-                            ->channels[n_channel_1]
-                            .time_vs_reference_time_gate(
-                                analysis.energy_sensitive_detectors[n_detector_1]
-                                    ->channels[n_channel_1]
-                                    .time_vs_reference_time_calibrated)) {
-                        energy_sensitive_detector_histograms
-                            [n_detector_1][n_channel_1]
-                                ->Fill(analysis
-                                        .energy_sensitive_detectors[n_detector_1]
-                                        ->channels[n_channel_1]
-                                        .energy_calibrated);
-                        time_vs_reference_time_histograms[n_detector_1][n_channel_1]
-                            ->Fill(
-                                analysis.energy_sensitive_detectors[n_detector_1]
-                                    ->channels[n_channel_1]
-                                    .time_vs_reference_time_calibrated);
+    HistogramSet1D histograms(analysis, time_difference_pairs);
 
-                        for (size_t n_channel_2 = n_channel_1 + 1;
-                            n_channel_2 <
-                            analysis.energy_sensitive_detectors[n_detector_1]
-                                ->channels.size();
-                            ++n_channel_2) {
-                            if (!isnan(analysis
-                                        .energy_sensitive_detectors[n_detector_1]
-                                        ->channels[n_channel_2]
-                                        .energy_calibrated) &&
-                                analysis.energy_sensitive_detectors[n_detector_1]
-                                    ->channels[n_channel_2]
-                                    .time_vs_reference_time_gate(
-                                        analysis
-                                            .energy_sensitive_detectors
-                                                [n_detector_1]
-                                            ->channels[n_channel_2]
-                                            .time_vs_reference_time_calibrated)) {
-                                time_difference_histograms
-                                    [n_detector_1][n_channel_1][0]
-                                    [n_channel_2 - n_channel_1 - 1]
-                                        ->Fill(analysis
-                                                .energy_sensitive_detectors
-                                                    [n_detector_1]
-                                                ->channels[n_channel_1]
-                                                .time_calibrated -
-                                            analysis
-                                                .energy_sensitive_detectors
-                                                    [n_detector_1]
-                                                ->channels[n_channel_2]
-                                                .time_calibrated);
-                            }
-                        }
+    if (pipeline) {
+        // The reader fills the raw leaves of 'analysis', and the other stages
+        // work on their own clones.
+        Analysis calibration_analysis = analysis.clone();
+        Analysis fill_analysis = analysis.clone();
+        ProgressPrinter progress_printer(reader.first, reader.last);
+        Pipeline stages(batch_size);
+        stages.run(
+            reader, analysis,
+            [&](CalibrationBatch &batch) {
+                calibration_analysis.calibrate_batch(batch);
+            },
+            [&](CalibrationBatch &batch) {
+                fill_histograms_from_calibrated_batch(fill_analysis, batch,
+                                                      &histograms);
+            },
+            &progress_printer);
+        stages.print_statistics();
+        reader.print_statistics();
+        reader.finalize();
+    } else if (n_threads <= 1) {
+        ProgressPrinter progress_printer(reader.first, reader.last);
+        fill_histograms(reader, analysis, calibrate, batch_size, &histograms,
+                        &progress_printer);
+        reader.print_statistics();
+        reader.finalize();
+    } else {
+        reader.finalize();
+        const long long n_entries = reader.last - reader.first + 1;
+        const vector<pair<long long, long long>> blocks = divide_into_blocks(
+            reader.first, reader.last, (n_entries + n_threads - 1) / n_threads);
 
-                        for (size_t n_detector_2 = n_detector_1 + 1;
-                            n_detector_2 <
-                            analysis.energy_sensitive_detectors.size();
-                            ++n_detector_2) {
-                            for (size_t n_channel_2 = 0;
-                                n_channel_2 <
-                                analysis.energy_sensitive_detectors[n_detector_2]
-                                    ->channels.size();
-                                ++n_channel_2) {
-                                if (!isnan(analysis
-                                            .energy_sensitive_detectors
-                                                [n_detector_2]
-                                            ->channels[n_channel_2]
-                                            .energy_calibrated) &&
-                                    analysis
-                                        .energy_sensitive_detectors[n_detector_2]
-                                        ->channels[n_channel_2]
-                                        .time_vs_reference_time_gate(
-                                            analysis
-                                                .energy_sensitive_detectors
-                                                    [n_detector_2]
-                                                ->channels[n_channel_2]
-                                                .time_vs_reference_time_calibrated)) {
-                                    time_difference_histograms
-                                        [n_detector_1][n_channel_1]
-                                        [n_detector_2 - n_detector_1][n_channel_2]
-                                            ->Fill(analysis
-                                                    .energy_sensitive_detectors
-                                                        [n_detector_1]
-                                                    ->channels[n_channel_1]
-                                                    .time_calibrated -
-                                                analysis
-                                                    .energy_sensitive_detectors
-                                                        [n_detector_2]
-                                                    ->channels[n_channel_2]
-                                                    .time_calibrated);
-                                }
-                            }
-                        }
-                    }
-                }
-                if (analysis.energy_sensitive_detectors[n_detector_1]
-                            ->channels.size() > 1 &&
-                    !isnan(analysis.energy_sensitive_detectors[n_detector_1]
-                            ->addback_energy)) {
-                    addback_histograms[n_detector_1]->Fill(
-                        analysis.energy_sensitive_detectors[n_detector_1]
-                            ->addback_energy);
-                }
-            }
-            for (size_t n_detector = 0;
-                n_detector < analysis.counter_detectors.size(); ++n_detector) {
-                for (size_t n_channel = 0;
-                    n_channel <
-                    analysis.counter_detectors[n_detector]->channels.size();
-                    ++n_channel) {
-                    if (!isnan(analysis.counter_detectors[n_detector]
-                                ->channels[n_channel]
-                                .count_rate)) {
-                        counter_detector_histograms[n_detector][n_channel]->Fill(
-                            analysis.counter_detectors[n_detector]
-                                ->channels[n_channel]
-                                .count_rate);
-                    }
-                }
-            }
-            if (vm.count("calibrate")) {
-                analysis.reset_raw_energy_sensitive_detector_leaves({true, true, true, false});
-                analysis.reset_calibrated_leaves();
-            }
+        vector<Analysis> block_analyses;
+        block_analyses.reserve(blocks.size());
+        vector<unique_ptr<HistogramSet1D>> block_histograms;
+        for (size_t n_block = 0; n_block < blocks.size(); ++n_block) {
+            block_analyses.push_back(analysis.clone());
+            block_histograms.push_back(
+                make_unique<HistogramSet1D>(block_analyses[n_block],
+                                            time_difference_pairs));
         }
-        progress_printer(reader.entry);
-        status = 0;
-    }
 
-    TFile output_file(vm["output"].as<string>().c_str(), "RECREATE");
-    TDirectory *directory = nullptr;
+        cout << "Processing entries [" << reader.first << ", " << reader.last
+             << "] in " << blocks.size() << " blocks on " << n_threads
+             << " threads." << endl;
+        mutex cout_mutex;
+        process_blocks_in_parallel(
+            blocks.size(), n_threads,
+            [&](const size_t n_block,
+                [[maybe_unused]] const unsigned int n_thread) {
+                if (calibrate && n_block > 0) {
+                    Reader previous_entry_reader(input_files,
+                                                 blocks[n_block].first - 1,
+                                                 blocks[n_block].first - 1,
+                                                 reader_mode);
+                    previous_entry_reader.tree_cache = reader.tree_cache;
+                    previous_entry_reader.event_window = reader.event_window;
+                    initialize_reader(previous_entry_reader,
+                                      block_analyses[n_block], tree_name,
+                                      calibrate);
+                    fill_histograms(previous_entry_reader,
+                                    block_analyses[n_block], calibrate, 1,
+                                    nullptr, nullptr);
+                    previous_entry_reader.finalize();
+                }
+                Reader block_reader(input_files, blocks[n_block].first,
+                                    blocks[n_block].second, reader_mode);
+                block_reader.tree_cache = reader.tree_cache;
+                block_reader.event_window = reader.event_window;
+                initialize_reader(block_reader, block_analyses[n_block],
+                                  tree_name, calibrate);
+                fill_histograms(block_reader, block_analyses[n_block],
+                                calibrate, batch_size,
+                                block_histograms[n_block].get(), nullptr);
+                block_reader.finalize();
 
-    for (size_t n_detector_1 = 0;
-         n_detector_1 < analysis.energy_sensitive_detectors.size();
-         ++n_detector_1) {
-        directory = output_file.mkdir(
-            (analysis.energy_sensitive_detectors[n_detector_1]->name + "_tdiff")
-                .c_str());
-        if (analysis.energy_sensitive_detectors[n_detector_1]->channels.size() >
-            1) {
-            addback_histograms[n_detector_1]->Write();
-        }
-        for (size_t n_channel_1 = 0;
-             n_channel_1 <
-             analysis.energy_sensitive_detectors[n_detector_1]->channels.size();
-             ++n_channel_1) {
-            energy_sensitive_detector_histograms[n_detector_1][n_channel_1]
-                ->Write();
-            directory->cd();
-            time_vs_reference_time_histograms[n_detector_1][n_channel_1]
-                ->Write();
+                lock_guard<mutex> lock(cout_mutex);
+                cout << "Processed block [" << blocks[n_block].first << ", "
+                     << blocks[n_block].second << "]." << endl;
+            });
 
-            for (size_t n_channel_2 = n_channel_1 + 1;
-                 n_channel_2 <
-                 analysis.energy_sensitive_detectors[n_detector_1]
-                     ->channels.size();
-                 ++n_channel_2) {
-                time_difference_histograms[n_detector_1][n_channel_1][0]
-                                          [n_channel_2 - n_channel_1 - 1]
-                                              ->Write();
-            }
-            for (size_t n_detector_2 = n_detector_1 + 1;
-                 n_detector_2 < analysis.energy_sensitive_detectors.size();
-                 ++n_detector_2) {
-                for (size_t n_channel_2 = 0;
-                     n_channel_2 <
-                     analysis.energy_sensitive_detectors[n_detector_2]
-                         ->channels.size();
-                     ++n_channel_2) {
-                    time_difference_histograms[n_detector_1][n_channel_1]
-                                              [n_detector_2 - n_detector_1]
-                                              [n_channel_2]
-                                                  ->Write();
-                }
-            }
-            output_file.cd();
-        }
-    }
-    for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
-         ++n_detector) {
-        for (size_t n_channel = 0;
-             n_channel <
-             analysis.counter_detectors[n_detector]->channels.size();
-             ++n_channel) {
-            counter_detector_histograms[n_detector][n_channel]->Write();
+        for (size_t n_block = 0; n_block < blocks.size(); ++n_block) {
+            histograms.add(*block_histograms[n_block]);
         }
+        reader.tree_cache.print_statistics();
     }
 
+    TFile output_file(vm["output"].as<string>().c_str(), "RECREATE");
+    histograms.write(analysis, output_file);
     output_file.Close();
     cout << "Created output file '" << vm["output"].as<string>() << "'."
          << endl;
+    print_peak_resident_set_size();
 }
\ No newline at end of file
@@ -23,138 +23,180 @@ using std::endl;
 #include "TChain.h"
 #include "TFile.h"
 #include "TH1D.h"
+#include "TROOT.h"
 
+#include "calibration_batch.hpp"
 #include "command_line_parser.hpp"
 #include "counter_detector_channel.hpp"
+#include "counting_histogram.hpp"
 #include "energy_sensitive_detector_channel.hpp"
 #include "histograms_1d_raw.hpp"
+#include "pipeline.hpp"
 #include "progress_printer.hpp"
 #include "tfile_utilities.hpp"
 
+// Raw data of the global channel index n_channel_index in event n_event of a
+// batch (see Analysis::add_to_batch()).
+void fill_histograms_from_batch(
+    Analysis &analysis, const CalibrationBatch &batch,
+    vector<vector<CountingHistogram1D<>>> &energy_sensitive_detector_histograms,
+    vector<vector<CountingHistogram1D<>>> &counter_detector_histograms) {
+    for (size_t n_event = 0; n_event < batch.n_events; ++n_event) {
+        size_t n_channel_index = 0;
+        for (auto &histogram_list : energy_sensitive_detector_histograms) {
+            for (auto &histogram : histogram_list) {
+                const double amplitude =
+                    analysis.channel_modules[n_channel_index]->dither(
+                        batch.amplitude[batch.index(n_channel_index, n_event)],
+                        batch.entries[n_event],
+                        analysis.channel_leaves[n_channel_index]);
+                if (!isnan(amplitude)) {
+                    histogram.fill(amplitude);
+                }
+                ++n_channel_index;
+            }
+        }
+        n_channel_index = 0;
+        for (auto &histogram_list : counter_detector_histograms) {
+            for (auto &histogram : histogram_list) {
+                histogram.fill(
+                    batch.counts[batch.index(n_channel_index, n_event)]);
+                ++n_channel_index;
+            }
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     CommandLineParser command_line_parser;
+    command_line_parser.desc.add_options()(
+        "batch", po::value<size_t>()->default_value(256),
+        "Number of entries per batch in the pipeline (default: 256).")(
+        "pipeline", "Read the entries and fill the histograms in two threads "
+                    "that pass batches of '--batch' entries to each other "
+                    "(default: fill the histograms entry by entry).");
     int command_line_parser_status;
     command_line_parser(argc, argv, command_line_parser_status);
     if (command_line_parser_status) {
         return 0;
     }
     po::variables_map vm = command_line_parser.get_variables_map();
+    if (vm["batch"].as<size_t>() < 1) {
+        cout << "Error: '--batch' must be at least 1. Aborting ..." << endl;
+        abort();
+    }
+    const bool pipeline = vm.count("pipeline");
+    if (pipeline) {
+        ROOT::EnableThreadSafety();
+    }
 
     Reader reader(vm.count("list") == 0
                       ? vm["input"].as<vector<string>>()
                       : read_log_file(vm["input"].as<vector<string>>()[0]),
-                  vm["first"].as<long long>(), vm["last"].as<long long>());
+                  vm["first"].as<long long>(), vm["last"].as<long long>(),
+                  vm["reader-mode"].as<string>());
+    reader.tree_cache = command_line_parser.get_tree_cache();
+    reader.event_window = vm["event-window"].as<long long>();
     reader.initialize(analysis, vm["tree"].as<string>(), {true},
                       {true, false, false, false});
     ProgressPrinter progress_printer(reader.first, reader.last);
 
-    vector<vector<TH1D *>> energy_sensitive_detector_histograms;
-    vector<vector<TH1D *>> counter_detector_histograms;
-    string histogram_name;
+    vector<vector<CountingHistogram1D<>>> energy_sensitive_detector_histograms;
+    vector<vector<CountingHistogram1D<>>> counter_detector_histograms;
 
     for (size_t n_detector = 0;
          n_detector < analysis.energy_sensitive_detectors.size();
          ++n_detector) {
-        energy_sensitive_detector_histograms.push_back(vector<TH1D *>());
-        for (auto channel :
-             analysis.energy_sensitive_detectors[n_detector]->channels) {
-            histogram_name =
-                analysis.energy_sensitive_detectors[n_detector]->name + "_" +
-                channel.name;
-            energy_sensitive_detector_histograms[n_detector].push_back(new TH1D(
-                histogram_name.c_str(), histogram_name.c_str(),
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector]
-                                  ->group]]
-                    ->raw_histogram_properties.n_bins,
-                analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector]
-                                  ->group]]
-                    ->raw_histogram_properties.lower_edge_of_first_bin,
+        const auto detector = analysis.energy_sensitive_detectors[n_detector];
+        energy_sensitive_detector_histograms.push_back(
+            vector<CountingHistogram1D<>>());
+        for (auto channel : detector->channels) {
+            energy_sensitive_detector_histograms[n_detector].emplace_back(
+                detector->name + "_" + channel.name,
                 analysis
-                    .energy_sensitive_detector_groups
-                        [analysis.group_index
-                             [analysis.energy_sensitive_detectors[n_detector]
-                                  ->group]]
-                    ->raw_histogram_properties.upper_edge_of_last_bin));
+                    .energy_sensitive_detector_groups[analysis.group_index
+                                                          [detector->group]]
+                    ->raw_histogram_properties);
         }
     }
     for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
          ++n_detector) {
-        counter_detector_histograms.push_back(vector<TH1D *>());
-        for (auto channel : analysis.counter_detectors[n_detector]->channels) {
-            histogram_name = analysis.counter_detectors[n_detector]->name +
-                             "_" + channel.name;
-            counter_detector_histograms[n_detector].push_back(new TH1D(
-                histogram_name.c_str(), histogram_name.c_str(),
-                analysis
-                    .counter_detector_groups
-                        [analysis.group_index
-                             [analysis.counter_detectors[n_detector]->group]]
-                    ->raw_histogram_properties.n_bins,
-                analysis
-                    .counter_detector_groups
-                        [analysis.group_index
-                             [analysis.counter_detectors[n_detector]->group]]
-                    ->raw_histogram_properties.lower_edge_of_first_bin,
-                analysis
-                    .counter_detector_groups
-                        [analysis.group_index
-                             [analysis.counter_detectors[n_detector]->group]]
-                    ->raw_histogram_properties.upper_edge_of_last_bin));
+        const auto detector = analysis.counter_detectors[n_detector];
+        counter_detector_histograms.push_back(vector<CountingHistogram1D<>>());
+        for (auto channel : detector->channels) {
+            counter_detector_histograms[n_detector].emplace_back(
+                detector->name + "_" + channel.name,
+                analysis.counter_detector_groups[analysis.group_index
+                                                     [detector->group]]
+                    ->raw_histogram_properties);
         }
     }
 
-    double amplitude;
-    unsigned int status;
-
-    while (reader.read(status, analysis)) {
-        for (size_t n_detector = 0;
-             n_detector < analysis.energy_sensitive_detectors.size();
-             ++n_detector) {
-            for (size_t n_channel = 0;
-                 n_channel < analysis.energy_sensitive_detectors[n_detector]
-                                 ->channels.size();
-                 ++n_channel) {
-                amplitude = analysis.get_amplitude(n_detector, n_channel);
-                if (!isnan(amplitude)) {
-                    energy_sensitive_detector_histograms[n_detector][n_channel]
-                        ->Fill(amplitude);
+    if (pipeline) {
+        // The fill stage works on a clone, whose modules are not written by
+        // the reader.
+        Analysis fill_analysis = analysis.clone();
+        Pipeline stages(vm["batch"].as<size_t>());
+        stages.run(
+            reader, analysis, []([[maybe_unused]] CalibrationBatch &batch) {},
+            [&](CalibrationBatch &batch) {
+                fill_histograms_from_batch(
+                    fill_analysis, batch, energy_sensitive_detector_histograms,
+                    counter_detector_histograms);
+            },
+            &progress_printer);
+        stages.print_statistics();
+    } else {
+        double amplitude;
+        unsigned int status;
+
+        while (reader.read(status, analysis)) {
+            for (size_t n_detector = 0;
+                 n_detector < analysis.energy_sensitive_detectors.size();
+                 ++n_detector) {
+                for (size_t n_channel = 0;
+                     n_channel < analysis.energy_sensitive_detectors[n_detector]
+                                     ->channels.size();
+                     ++n_channel) {
+                    amplitude = analysis.get_amplitude(n_detector, n_channel,
+                                                       reader.entry);
+                    if (!isnan(amplitude)) {
+                        energy_sensitive_detector_histograms
+                            [n_detector][n_channel]
+                                .fill(amplitude);
+                    }
                 }
             }
-        }
-        for (size_t n_detector = 0;
-             n_detector < analysis.counter_detectors.size(); ++n_detector) {
-            for (size_t n_channel = 0;
-                 n_channel <
-                 analysis.counter_detectors[n_detector]->channels.size();
-                 ++n_channel) {
-                counter_detector_histograms[n_detector][n_channel]->Fill(
-                    analysis.get_counts(n_detector, n_channel));
+            for (size_t n_detector = 0;
+                 n_detector < analysis.counter_detectors.size(); ++n_detector) {
+                for (size_t n_channel = 0;
+                     n_channel <
+                     analysis.counter_detectors[n_detector]->channels.size();
+                     ++n_channel) {
+                    counter_detector_histograms[n_detector][n_channel].fill(
+                        analysis.get_counts(n_detector, n_channel));
+                }
             }
+            progress_printer(reader.entry);
+            analysis.reset_raw_counter_detector_leaves({true});
+            analysis.reset_raw_energy_sensitive_detector_leaves(
+                {true, false, false, false});
         }
-        progress_printer(reader.entry);
-        analysis.reset_raw_counter_detector_leaves({true});
-        analysis.reset_raw_energy_sensitive_detector_leaves(
-            {true, false, false, false});
     }
 
+    reader.print_statistics();
     reader.finalize();
 
     TFile output_file(vm["output"].as<string>().c_str(), "RECREATE");
 
-    for (auto histogram_list : energy_sensitive_detector_histograms) {
-        for (auto histogram : histogram_list) {
-            histogram->Write();
+    for (const auto &histogram_list : energy_sensitive_detector_histograms) {
+        for (const auto &histogram : histogram_list) {
+            histogram.write<TH1D>();
         }
     }
-    for (auto histogram_list : counter_detector_histograms) {
-        for (auto histogram : histogram_list) {
-            histogram->Write();
+    for (const auto &histogram_list : counter_detector_histograms) {
+        for (const auto &histogram : histogram_list) {
+            histogram.write<TH1D>();
         }
     }
 
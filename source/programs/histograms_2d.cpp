@@ -15,11 +15,6 @@
     carolina. If not, see <https://www.gnu.org/licenses/>.
 */
 
-#include <algorithm>
-
-using std::max;
-using std::min;
-
 #include <iostream>
 
 using std::cout;
@@ -27,24 +22,64 @@ using std::endl;
 
 #include <memory>
 
-using std::dynamic_pointer_cast;
+using std::make_unique;
+using std::unique_ptr;
+
+#include <mutex>
+
+using std::lock_guard;
+using std::mutex;
 
 #include "TChain.h"
 #include "TFile.h"
-#include "TH2I.h"
+#include "TROOT.h"
 
+#include "block_scheduler.hpp"
+#include "bulk_tree_reader.hpp"
+#include "coincidence_matrix_set.hpp"
 #include "command_line_parser.hpp"
-#include "energy_sensitive_detector.hpp"
-#include "energy_sensitive_detector_channel.hpp"
 #include "histograms_2d.hpp"
+#include "memory_usage.hpp"
 #include "progress_printer.hpp"
 #include "tfile_utilities.hpp"
 
-void fill(TH2I *histogram, const CoincidenceMatrix matrix,
-          const double energy_1, const double energy_2) {
-    histogram->Fill(energy_1, energy_2);
-    if (!matrix.detectors_y.size()) {
-        histogram->Fill(energy_2, energy_1);
+void set_up_branches(TChain *tree, Analysis &analysis, const bool calibrate,
+                     const TreeCache &tree_cache) {
+    tree->SetBranchStatus("*", 0);
+    if (calibrate) {
+        analysis.set_up_raw_counter_detector_branches_for_reading(tree, {true});
+        analysis.set_up_raw_energy_sensitive_detector_branches_for_reading(
+            tree, {true, true, true, true});
+    } else {
+        analysis.set_up_calibrated_counter_detector_branches_for_reading(tree);
+        analysis
+            .set_up_calibrated_energy_sensitive_detector_branches_for_reading(
+                tree);
+    }
+    tree_cache.set_up(tree);
+}
+
+// Fill the entries [first, last] into the coincidence matrices.
+void fill_histograms(BulkTreeReader &tree_reader, Analysis &analysis,
+                     const long long first, const long long last,
+                     const bool calibrate, CoincidenceMatrixSet &histograms,
+                     ProgressPrinter *progress_printer) {
+    for (long long i = first; i <= last; ++i) {
+        tree_reader.get_entry(i);
+        if (calibrate) {
+            analysis.calibrate(i);
+        } else {
+            analysis.update_valid_channels();
+        }
+
+        histograms.fill(analysis);
+
+        if (calibrate) {
+            analysis.reset_calibrated_leaves();
+        }
+        if (progress_printer != nullptr) {
+            (*progress_printer)(i);
+        }
     }
 }
 
@@ -54,7 +89,18 @@ int main(int argc, char **argv) {
         "calibrate", "Assume that the input file contains raw data that need "
                      "to be calibrated by 'histograms_2d'."
                      "The default assumption is that the input file is "
-                     "output of the 'calibrate_tree' script.");
+                     "output of the 'calibrate_tree' script.")(
+        "dense", "Write the coincidence matrices as TH2I instead of "
+                 "THnSparseI. The matrices are always filled in tiles that are "
+                 "only allocated when they are filled, but a TH2I with all "
+                 "bins of a matrix is created when it is written. Avoid this "
+                 "for matrices with a large number of bins, for example with "
+                 "the full resolution of the spectra (default: write "
+                 "THnSparseI).")(
+        "threads", po::value<unsigned int>()->default_value(1),
+        "Number of threads. The range of entries is divided into one block "
+        "per thread, each thread fills its own set of matrices, and the sets "
+        "are added after all blocks have been processed (default: 1).");
     int command_line_parser_status;
     command_line_parser(argc, argv, command_line_parser_status);
     if (command_line_parser_status) {
@@ -62,85 +108,93 @@ int main(int argc, char **argv) {
     }
     const po::variables_map vm = command_line_parser.get_variables_map();
 
+    const bool calibrate = vm.count("calibrate");
+    const bool sparse = !vm.count("dense");
+    const bool bulk = vm["reader-mode"].as<string>() == "bulk";
+    const unsigned int n_threads = vm["threads"].as<unsigned int>();
+
+    const TreeCache tree_cache = command_line_parser.get_tree_cache();
     long long first, last;
     TChain *tree =
         command_line_parser.set_up_tree(first, last, vm.count("list"));
 
-    ProgressPrinter progress_printer(first, last);
+    CoincidenceMatrixSet coincidence_histograms(analysis);
 
-    tree->SetBranchStatus("*", 0);
-    if (vm.count("calibrate")) {
-        analysis.set_up_raw_counter_detector_branches_for_reading(tree, {true});
-        analysis.set_up_raw_energy_sensitive_detector_branches_for_reading(
-            tree, {true, true, true, true});
+    if (n_threads <= 1) {
+        set_up_branches(tree, analysis, calibrate, tree_cache);
+        BulkTreeReader tree_reader(tree, bulk);
+        ProgressPrinter progress_printer(first, last);
+        fill_histograms(tree_reader, analysis, first, last, calibrate,
+                        coincidence_histograms, &progress_printer);
+        tree_cache.print_statistics(tree);
+        delete tree;
     } else {
-        analysis.set_up_calibrated_counter_detector_branches_for_reading(tree);
-        analysis
-            .set_up_calibrated_energy_sensitive_detector_branches_for_reading(
-                tree);
-    }
-
-    vector<vector<pair<size_t, size_t>>> coincidence_pairs;
-    vector<TH2I *> coincidence_histograms;
-    string histogram_name;
-
-    for (auto matrix : analysis.coincidence_matrices) {
-        coincidence_pairs.push_back(matrix.get_coincidence_pairs());
-        coincidence_histograms.push_back(new TH2I(
-            matrix.name.c_str(), matrix.name.c_str(), matrix.x_axis.n_bins,
-            matrix.x_axis.lower_edge_of_first_bin,
-            matrix.x_axis.upper_edge_of_last_bin, matrix.y_axis.n_bins,
-            matrix.y_axis.lower_edge_of_first_bin,
-            matrix.y_axis.upper_edge_of_last_bin));
-    }
-
-    for (long long i = first; i <= last; ++i) {
-        tree->GetEntry(i);
-        if (vm.count("calibrate")) {
-            analysis.calibrate(i);
+        delete tree;
+        ROOT::EnableThreadSafety();
+        const vector<pair<long long, long long>> blocks = divide_into_blocks(
+            first, last, (last - first + n_threads) / n_threads);
+
+        // Thread 0 uses the global analysis object, all other threads work on
+        // a clone.
+        vector<Analysis> thread_analyses;
+        vector<unique_ptr<CoincidenceMatrixSet>> thread_histograms;
+        for (unsigned int n_thread = 1; n_thread < n_threads; ++n_thread) {
+            thread_analyses.push_back(analysis.clone());
+            thread_histograms.push_back(
+                make_unique<CoincidenceMatrixSet>(analysis));
         }
 
-        for (size_t n_matrix = 0;
-             n_matrix < analysis.coincidence_matrices.size(); ++n_matrix) {
-            for (auto detector_pair : coincidence_pairs[n_matrix]) {
-                if (!isnan(
-                        analysis
-                            .energy_sensitive_detectors
-                                [analysis.detector_index[detector_pair.first]]
-                            ->get_calibrated_and_RF_gated_energy()) &&
-                    !isnan(
-                        analysis
-                            .energy_sensitive_detectors
-                                [analysis.detector_index[detector_pair.second]]
-                            ->get_calibrated_and_RF_gated_energy())) {
-                    fill(coincidence_histograms[n_matrix],
-                         analysis.coincidence_matrices[n_matrix],
-                         analysis
-                             .energy_sensitive_detectors
-                                 [analysis.detector_index[detector_pair.first]]
-                             ->get_calibrated_and_RF_gated_energy(),
-                         analysis
-                             .energy_sensitive_detectors
-                                 [analysis.detector_index[detector_pair.second]]
-                             ->get_calibrated_and_RF_gated_energy());
+        cout << "Processing entries [" << first << ", " << last << "] in "
+             << blocks.size() << " blocks on " << n_threads << " threads."
+             << endl;
+        mutex cout_mutex;
+        process_blocks_in_parallel(
+            blocks.size(), n_threads,
+            [&](const size_t n_block, const unsigned int n_thread) {
+                Analysis &thread_analysis =
+                    n_thread == 0 ? analysis : thread_analyses[n_thread - 1];
+                long long tree_first, tree_last;
+                TChain *block_tree = command_line_parser.set_up_tree(
+                    tree_first, tree_last, vm.count("list"));
+                set_up_branches(block_tree, thread_analysis, calibrate,
+                                tree_cache);
+                BulkTreeReader tree_reader(block_tree, bulk);
+
+                // Calibrate the entry before the block to restore the state
+                // that a serial loop would have (e.g. the previous counts of
+                // the counter detectors).
+                if (calibrate && n_block > 0) {
+                    tree_reader.get_entry(blocks[n_block].first - 1);
+                    thread_analysis.calibrate(blocks[n_block].first - 1);
+                    thread_analysis.reset_calibrated_leaves();
                 }
-            }
-        }
 
-        if (vm.count("calibrate")) {
-            analysis.reset_calibrated_leaves();
+                fill_histograms(tree_reader, thread_analysis,
+                                blocks[n_block].first, blocks[n_block].second,
+                                calibrate,
+                                n_thread == 0
+                                    ? coincidence_histograms
+                                    : *thread_histograms[n_thread - 1],
+                                nullptr);
+                delete block_tree;
+
+                lock_guard<mutex> lock(cout_mutex);
+                cout << "Processed block [" << blocks[n_block].first << ", "
+                     << blocks[n_block].second << "]." << endl;
+            });
+
+        for (const auto &histograms : thread_histograms) {
+            coincidence_histograms.add(*histograms);
         }
-        progress_printer(i);
+        tree_cache.print_statistics();
     }
 
     TFile output_file(vm["output"].as<string>().c_str(), "RECREATE");
 
-    for (size_t n_histogram = 0; n_histogram < coincidence_histograms.size();
-         ++n_histogram) {
-        coincidence_histograms[n_histogram]->Write();
-    }
+    coincidence_histograms.write(sparse);
 
     output_file.Close();
     cout << "Created output file '" << vm["output"].as<string>() << "'."
          << endl;
-}
\ No newline at end of file
+    print_peak_resident_set_size();
+}
@@ -26,12 +26,11 @@ using std::dynamic_pointer_cast;
 
 #include "TChain.h"
 #include "TFile.h"
-#include "TH2I.h"
 
+#include "bulk_tree_reader.hpp"
 #include "command_line_parser.hpp"
-#include "counter_detector_channel.hpp"
-#include "energy_sensitive_detector_channel.hpp"
 #include "history.hpp"
+#include "history_set.hpp"
 #include "progress_printer.hpp"
 #include "tfile_utilities.hpp"
 
@@ -44,6 +43,7 @@ int main(int argc, char **argv) {
     }
     const po::variables_map vm = command_line_parser.get_variables_map();
 
+    const TreeCache tree_cache = command_line_parser.get_tree_cache();
     long long first, last;
     TChain *tree =
         command_line_parser.set_up_tree(first, last, vm.count("list"));
@@ -54,128 +54,22 @@ int main(int argc, char **argv) {
     analysis.set_up_calibrated_counter_detector_branches_for_reading(tree);
     analysis.set_up_calibrated_energy_sensitive_detector_branches_for_reading(
         tree);
+    tree_cache.set_up(tree);
+    BulkTreeReader tree_reader(tree, vm["reader-mode"].as<string>() == "bulk");
 
-    vector<vector<TH2I *>> energy_sensitive_detector_history_histograms;
-    vector<vector<TH2I *>> counter_detector_history_histograms;
-    string histogram_name;
-
-    for (size_t n_detector = 0;
-         n_detector < analysis.energy_sensitive_detectors.size();
-         ++n_detector) {
-        energy_sensitive_detector_history_histograms.push_back(
-            vector<TH2I *>());
-        for (auto channel :
-             analysis.energy_sensitive_detectors[n_detector]->channels) {
-            histogram_name =
-                analysis.detectors[n_detector]->name + "_" + channel.name;
-            energy_sensitive_detector_history_histograms[n_detector].push_back(
-                new TH2I(
-                    histogram_name.c_str(), histogram_name.c_str(), 256, first,
-                    last,
-                    analysis
-                        .energy_sensitive_detector_groups
-                            [analysis.group_index
-                                 [analysis
-                                      .energy_sensitive_detectors[n_detector]
-                                      ->group]]
-                        ->histogram_properties.n_bins,
-                    analysis
-                        .energy_sensitive_detector_groups
-                            [analysis.group_index
-                                 [analysis
-                                      .energy_sensitive_detectors[n_detector]
-                                      ->group]]
-                        ->histogram_properties.lower_edge_of_first_bin,
-                    analysis
-                        .energy_sensitive_detector_groups
-                            [analysis.group_index
-                                 [analysis
-                                      .energy_sensitive_detectors[n_detector]
-                                      ->group]]
-                        ->histogram_properties.upper_edge_of_last_bin));
-        }
-    }
-    for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
-         ++n_detector) {
-        counter_detector_history_histograms.push_back(vector<TH2I *>());
-        for (auto channel : analysis.counter_detectors[n_detector]->channels) {
-            histogram_name = analysis.counter_detectors[n_detector]->name +
-                             "_" + channel.name;
-            counter_detector_history_histograms[n_detector].push_back(new TH2I(
-                histogram_name.c_str(), histogram_name.c_str(), 256, first,
-                last,
-                analysis
-                    .counter_detector_groups
-                        [analysis.group_index
-                             [analysis.counter_detectors[n_detector]->group]]
-                    ->histogram_properties.n_bins,
-                analysis
-                    .counter_detector_groups
-                        [analysis.group_index
-                             [analysis.counter_detectors[n_detector]->group]]
-                    ->histogram_properties.lower_edge_of_first_bin,
-                analysis
-                    .counter_detector_groups
-                        [analysis.group_index
-                             [analysis.counter_detectors[n_detector]->group]]
-                    ->histogram_properties.upper_edge_of_last_bin));
-        }
-    }
+    HistorySet history_histograms(analysis, first, last);
 
     for (long long i = first; i <= last; ++i) {
-        tree->GetEntry(i);
-
-        for (size_t n_detector = 0;
-             n_detector < analysis.energy_sensitive_detectors.size();
-             ++n_detector) {
-            for (size_t n_channel = 0;
-                 n_channel < analysis.energy_sensitive_detectors[n_detector]
-                                 ->channels.size();
-                 ++n_channel) {
-                if (!isnan(analysis.energy_sensitive_detectors[n_detector]
-                               ->channels[n_channel]
-                               .energy_calibrated)) {
-                    energy_sensitive_detector_history_histograms
-                        [n_detector][n_channel]
-                            ->Fill(
-                                i,
-                                analysis.energy_sensitive_detectors[n_detector]
-                                    ->channels[n_channel]
-                                    .energy_calibrated);
-                }
-            }
-        }
-        for (size_t n_detector = 0;
-             n_detector < analysis.counter_detectors.size(); ++n_detector) {
-            for (size_t n_channel = 0;
-                 n_channel <
-                 analysis.counter_detectors[n_detector]->channels.size();
-                 ++n_channel) {
-                if (!isnan(analysis.counter_detectors[n_detector]
-                               ->channels[n_channel]
-                               .count_rate)) {
-                    counter_detector_history_histograms[n_detector][n_channel]
-                        ->Fill(i, analysis.counter_detectors[n_detector]
-                                      ->channels[n_channel]
-                                      .count_rate);
-                }
-            }
-        }
+        tree_reader.get_entry(i);
+        history_histograms.fill(analysis, i);
         progress_printer(i);
     }
 
+    tree_cache.print_statistics(tree);
+
     TFile output_file(vm["output"].as<string>().c_str(), "RECREATE");
 
-    for (auto histogram_list : energy_sensitive_detector_history_histograms) {
-        for (auto histogram : histogram_list) {
-            histogram->Write();
-        }
-    }
-    for (auto histogram_list : counter_detector_history_histograms) {
-        for (auto histogram : histogram_list) {
-            histogram->Write();
-        }
-    }
+    history_histograms.write();
 
     output_file.Close();
     cout << "Created output file '" << vm["output"].as<string>() << "'."
@@ -23,27 +23,49 @@ using std::endl;
 #include "TChain.h"
 #include "TFile.h"
 #include "TH1D.h"
+#include "TROOT.h"
 
+#include "calibration_batch.hpp"
 #include "command_line_parser.hpp"
 #include "counter_detector_channel.hpp"
 #include "energy_sensitive_detector_channel.hpp"
 #include "mvlclst_to_root.hpp"
+#include "pipeline.hpp"
 #include "progress_printer.hpp"
 #include "tfile_utilities.hpp"
 
 int main(int argc, char **argv) {
     CommandLineParser command_line_parser;
+    command_line_parser.desc.add_options()(
+        "batch", po::value<size_t>()->default_value(256),
+        "Number of events per batch in the pipeline (default: 256).")(
+        "pipeline",
+        "Decode the input and fill the output tree in two threads that pass "
+        "batches of '--batch' events to each other. Only the raw data of the "
+        "channels that belong to a detector are written (default: fill the "
+        "tree event by event).");
     int command_line_parser_status;
     command_line_parser(argc, argv, command_line_parser_status);
     if (command_line_parser_status) {
         return 0;
     }
     po::variables_map vm = command_line_parser.get_variables_map();
+    if (vm["batch"].as<size_t>() < 1) {
+        cout << "Error: '--batch' must be at least 1. Aborting ..." << endl;
+        abort();
+    }
+    const bool pipeline = vm.count("pipeline");
+    if (pipeline) {
+        ROOT::EnableThreadSafety();
+    }
 
     Reader reader(vm.count("list") == 0
                       ? vm["input"].as<vector<string>>()
                       : read_log_file(vm["input"].as<vector<string>>()[0]),
-                  vm["first"].as<long long>(), vm["last"].as<long long>());
+                  vm["first"].as<long long>(), vm["last"].as<long long>(),
+                  vm["reader-mode"].as<string>());
+    reader.tree_cache = command_line_parser.get_tree_cache();
+    reader.event_window = vm["event-window"].as<long long>();
     reader.initialize(analysis, vm["tree"].as<string>(), {false},
                       {true, true, true, true});
     ProgressPrinter progress_printer(reader.first, reader.last);
@@ -51,18 +73,46 @@ int main(int argc, char **argv) {
     long long first, last;
     TFile output_file(vm["output"].as<string>().c_str(), "RECREATE");
     TTree *tree = new TTree("events", "events");
-    analysis.set_up_raw_energy_sensitive_detector_branches_for_writing(tree, {true, true, true, true});
 
-    unsigned int status;
+    if (pipeline) {
+        // The reader decodes the next events into the leaves of 'analysis',
+        // while the tree is filled from the leaves of a clone.
+        Analysis output_analysis = analysis.clone();
+        output_analysis
+            .set_up_raw_energy_sensitive_detector_branches_for_writing(
+                tree, {true, true, true, true});
+        Pipeline stages(vm["batch"].as<size_t>());
+        stages.run(
+            reader, analysis, []([[maybe_unused]] CalibrationBatch &batch) {},
+            [&](CalibrationBatch &batch) {
+                for (size_t n_event = 0; n_event < batch.n_events; ++n_event) {
+                    output_analysis.load_raw_from_batch(batch, n_event);
+                    tree->Fill();
+                    output_analysis.reset_raw_energy_sensitive_detector_leaves(
+                        {true, true, true, true});
+                }
+            },
+            &progress_printer);
+        stages.print_statistics();
+    } else {
+        analysis.set_up_raw_energy_sensitive_detector_branches_for_writing(
+            tree, {true, true, true, true});
 
-    while (reader.read(status, analysis)) {
-        if(status==1){
-            tree->Fill();
-            analysis.reset_raw_energy_sensitive_detector_leaves({true, true, true, true});
-            progress_printer(reader.entry);
+        unsigned int status;
+
+        while (reader.read(status, analysis)) {
+            if (status == 1) {
+                tree->Fill();
+                analysis.reset_raw_energy_sensitive_detector_leaves(
+                    {true, true, true, true});
+                progress_printer(reader.entry);
+            }
         }
     }
 
+    reader.print_statistics();
+    reader.finalize();
+
     tree->Write();
     output_file.Close();
 
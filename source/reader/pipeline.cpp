@@ -0,0 +1,134 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <chrono>
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <memory>
+
+using std::make_unique;
+using std::unique_ptr;
+
+#include <thread>
+
+using std::thread;
+
+#include <vector>
+
+using std::vector;
+
+#include "pipeline.hpp"
+#include "spsc_queue.hpp"
+
+// A nullptr marks the end of the input.
+typedef SPSCQueue<CalibrationBatch *> BatchQueue;
+
+void pop_batch(BatchQueue &queue, CalibrationBatch *&batch,
+               double &waiting_time) {
+    if (queue.try_pop(batch)) {
+        return;
+    }
+    const auto start = steady_clock::now();
+    queue.pop(batch);
+    waiting_time += duration<double>(steady_clock::now() - start).count();
+}
+
+Pipeline::Pipeline(const size_t batch_size, const size_t n_batches)
+    : batch_size(batch_size), n_batches(n_batches), n_events(0),
+      n_batches_read(0), read_waiting_time(0.), calibrate_waiting_time(0.),
+      fill_waiting_time(0.) {}
+
+void Pipeline::run(ReaderBase &reader, Analysis &analysis,
+                   const function<void(CalibrationBatch &)> &calibrate,
+                   const function<void(CalibrationBatch &)> &fill,
+                   ProgressPrinter *progress_printer) {
+    vector<unique_ptr<CalibrationBatch>> batches;
+    // All batches and the end marker fit into each queue, so only the pop
+    // operations have to wait.
+    BatchQueue free_batches(n_batches + 1), read_batches(n_batches + 1),
+        calibrated_batches(n_batches + 1);
+    for (size_t n_batch = 0; n_batch < n_batches; ++n_batch) {
+        batches.push_back(make_unique<CalibrationBatch>(analysis, batch_size));
+        free_batches.push(batches.back().get());
+    }
+
+    thread calibrate_thread([&]() {
+        CalibrationBatch *batch;
+        do {
+            pop_batch(read_batches, batch, calibrate_waiting_time);
+            if (batch != nullptr) {
+                calibrate(*batch);
+            }
+            calibrated_batches.push(batch);
+        } while (batch != nullptr);
+    });
+    thread fill_thread([&]() {
+        CalibrationBatch *batch;
+        while (true) {
+            pop_batch(calibrated_batches, batch, fill_waiting_time);
+            if (batch == nullptr) {
+                break;
+            }
+            fill(*batch);
+            batch->clear();
+            free_batches.push(batch);
+        }
+    });
+
+    CalibrationBatch *batch;
+    pop_batch(free_batches, batch, read_waiting_time);
+    unsigned int status;
+    while (reader.read(status, analysis)) {
+        if (status == 1) {
+            analysis.add_to_batch(*batch, reader.entry);
+            analysis.reset_raw_energy_sensitive_detector_leaves(
+                {true, true, true, true});
+            ++n_events;
+            if (batch->is_full()) {
+                read_batches.push(batch);
+                ++n_batches_read;
+                pop_batch(free_batches, batch, read_waiting_time);
+            }
+        }
+        if (progress_printer != nullptr) {
+            (*progress_printer)(reader.entry);
+        }
+    }
+    if (batch->n_events > 0) {
+        read_batches.push(batch);
+        ++n_batches_read;
+    }
+    read_batches.push(nullptr);
+
+    calibrate_thread.join();
+    fill_thread.join();
+}
+
+void Pipeline::print_statistics() const {
+    cout << "Processed " << n_events << " events in " << n_batches_read
+         << " batches of up to " << batch_size << " events. Time spent "
+         << "waiting: " << read_waiting_time << " s (read), "
+         << calibrate_waiting_time << " s (calibrate), " << fill_waiting_time
+         << " s (fill)." << endl;
+}
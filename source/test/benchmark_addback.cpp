@@ -0,0 +1,248 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+// Compare EnergySensitiveDetector::addback() with a reference implementation
+// of the previous algorithm, which kept per-channel state in vectors that were
+// reset after every event and called the std::function coincidence gates for
+// every pair of channels.
+// The benchmark uses a clover with four channels and events with 1, 2, and 4
+// channels that have an energy. The addback results of both implementations
+// must be identical.
+
+#include <cassert>
+
+#include <algorithm>
+
+using std::shuffle;
+
+#include <chrono>
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+#include <cmath>
+
+using std::isnan;
+
+#include <cstdlib>
+
+using std::atoi;
+
+#include <functional>
+
+using std::function;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <limits>
+
+using std::numeric_limits;
+
+#include <random>
+
+using std::mt19937;
+using std::uniform_real_distribution;
+
+#include <string>
+
+using std::string;
+using std::to_string;
+
+#include <vector>
+
+using std::vector;
+
+#include "energy_sensitive_detector.hpp"
+#include "energy_sensitive_detector_channel.hpp"
+#include "gate.hpp"
+
+const size_t n_channels = 4;
+
+EnergySensitiveDetector create_clover() {
+    vector<EnergySensitiveDetectorChannel> channels;
+    for (size_t n_channel = 0; n_channel < n_channels; ++n_channel) {
+        channels.push_back(EnergySensitiveDetectorChannel(
+            "E" + to_string(n_channel + 1), 0, n_channel));
+    }
+    vector<vector<function<bool(const double)>>> gates;
+    for (size_t n_c_0 = 0; n_c_0 < n_channels - 1; ++n_c_0) {
+        gates.push_back(vector<function<bool(const double)>>(
+            n_channels - n_c_0 - 1, Gate::gate(-2.5, 2.5)));
+    }
+    return EnergySensitiveDetector("clover", channels, 0, gates);
+}
+
+struct Event {
+    vector<double> energies, times;
+};
+
+// Each event has n_hits channels with an energy, chosen at random. The times
+// are spread such that some, but not all pairs of hits are coincident.
+vector<Event> create_events(const size_t n_events, const size_t n_hits) {
+    mt19937 random_engine(0);
+    uniform_real_distribution<double> energy_distribution(10., 5000.),
+        time_distribution(-5., 5.);
+    vector<size_t> channel_indices(n_channels);
+    for (size_t n_channel = 0; n_channel < n_channels; ++n_channel) {
+        channel_indices[n_channel] = n_channel;
+    }
+
+    vector<Event> events(n_events);
+    for (auto &event : events) {
+        event.energies =
+            vector<double>(n_channels, numeric_limits<double>::quiet_NaN());
+        event.times =
+            vector<double>(n_channels, numeric_limits<double>::quiet_NaN());
+        shuffle(channel_indices.begin(), channel_indices.end(), random_engine);
+        for (size_t n_hit = 0; n_hit < n_hits; ++n_hit) {
+            event.energies[channel_indices[n_hit]] =
+                energy_distribution(random_engine);
+            event.times[channel_indices[n_hit]] =
+                time_distribution(random_engine);
+        }
+    }
+    return events;
+}
+
+void set_channels(EnergySensitiveDetector &detector, const Event &event) {
+    for (size_t n_channel = 0; n_channel < n_channels; ++n_channel) {
+        detector.channels[n_channel].energy_calibrated() =
+            event.energies[n_channel];
+        detector.channels[n_channel].time_calibrated() =
+            event.times[n_channel];
+        detector.channels[n_channel].time_vs_reference_time_calibrated() =
+            event.times[n_channel];
+    }
+}
+
+struct ReferenceAddback {
+    ReferenceAddback()
+        : skip_channel(n_channels, false), addback_energies(n_channels),
+          addback_times(n_channels) {
+        reset();
+    }
+
+    vector<bool> skip_channel;
+    vector<double> addback_energies, addback_times;
+    double addback_energy, addback_time, addback_time_vs_reference_time;
+
+    void reset() {
+        for (size_t n_channel = 0; n_channel < n_channels; ++n_channel) {
+            skip_channel[n_channel] = false;
+            addback_energies[n_channel] = numeric_limits<double>::quiet_NaN();
+            addback_times[n_channel] = numeric_limits<double>::quiet_NaN();
+        }
+        addback_energy = numeric_limits<double>::quiet_NaN();
+        addback_time = numeric_limits<double>::quiet_NaN();
+        addback_time_vs_reference_time = numeric_limits<double>::quiet_NaN();
+    }
+
+    void operator()(const EnergySensitiveDetector &detector) {
+        const auto &channels = detector.channels;
+        size_t maximum_energy_deposition_index = 0;
+        for (size_t n_c_0 = 0; n_c_0 < n_channels; ++n_c_0) {
+            if (!isnan(channels[n_c_0].energy_calibrated()) &&
+                !skip_channel[n_c_0]) {
+                addback_energies[n_c_0] = channels[n_c_0].energy_calibrated();
+                addback_times[n_c_0] = channels[n_c_0].time_calibrated();
+                maximum_energy_deposition_index = n_c_0;
+                for (size_t n_c_1 = n_c_0 + 1; n_c_1 < n_channels; ++n_c_1) {
+                    if (!isnan(channels[n_c_1].energy_calibrated()) &&
+                        !skip_channel[n_c_1] &&
+                        detector.addback_coincidence_gates[n_c_0]
+                                                          [n_c_1 - n_c_0 - 1](
+                            channels[n_c_0].time_calibrated() -
+                            channels[n_c_1].time_calibrated())) {
+                        addback_energies[n_c_0] +=
+                            channels[n_c_1].energy_calibrated();
+                        skip_channel[n_c_1] = true;
+                        if (channels[n_c_1].energy_calibrated() >
+                            channels[n_c_0].energy_calibrated()) {
+                            maximum_energy_deposition_index = n_c_1;
+                        }
+                    }
+                }
+                addback_times[n_c_0] =
+                    channels[maximum_energy_deposition_index].time_calibrated();
+                skip_channel[n_c_0] = true;
+            }
+        }
+        for (size_t n_channel = 0; n_channel < n_channels; ++n_channel) {
+            if (isnan(addback_energy) ||
+                addback_energies[n_channel] > addback_energy) {
+                addback_energy = addback_energies[n_channel];
+                addback_time = addback_times[n_channel];
+                addback_time_vs_reference_time =
+                    channels[n_channel].time_vs_reference_time_calibrated();
+            }
+        }
+    }
+};
+
+bool identical(const double a, const double b) {
+    return (isnan(a) && isnan(b)) || a == b;
+}
+
+void benchmark(const size_t n_events, const size_t n_hits) {
+    const vector<Event> events = create_events(n_events, n_hits);
+    EnergySensitiveDetector detector = create_clover();
+    ReferenceAddback reference;
+
+    for (const auto &event : events) {
+        set_channels(detector, event);
+        reference(detector);
+        detector.addback();
+        assert(identical(detector.addback_energy, reference.addback_energy));
+        assert(identical(detector.addback_time, reference.addback_time));
+        assert(identical(detector.addback_time_vs_reference_time,
+                         reference.addback_time_vs_reference_time));
+        reference.reset();
+        detector.reset_addback();
+    }
+
+    // Both loops include setting the channels, which takes the same time for
+    // both implementations.
+    auto start = steady_clock::now();
+    for (const auto &event : events) {
+        set_channels(detector, event);
+        reference(detector);
+        reference.reset();
+    }
+    const double reference_time =
+        duration<double>(steady_clock::now() - start).count();
+    start = steady_clock::now();
+    for (const auto &event : events) {
+        set_channels(detector, event);
+        detector.addback();
+        detector.reset_addback();
+    }
+    const double time = duration<double>(steady_clock::now() - start).count();
+
+    cout << n_hits << "-fold hits: reference " << n_events / reference_time
+         << " events/s, bitmask " << n_events / time << " events/s (speedup "
+         << reference_time / time << ")" << endl;
+}
+
+int main(int argc, char **argv) {
+    const size_t n_events = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    for (size_t n_hits : {1, 2, 4}) {
+        benchmark(n_events, n_hits);
+    }
+}
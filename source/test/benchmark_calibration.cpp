@@ -0,0 +1,266 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Compare the calibration of one event at a time (Analysis::calibrate()) with
+// the batch calibration (Analysis::calibrate_batch()) on synthetic raw data.
+// The calibrated values of both methods must be identical.
+// The comparison is done for the test analysis, which contains custom
+// calibrations and dithered amplitudes, and for an array of four MDPP-16
+// modules with 16 detectors each that have polynomial calibrations and
+// interval gates.
+
+#include <cassert>
+
+#include <chrono>
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+#include <cmath>
+
+using std::isnan;
+
+#include <cstdlib>
+
+using std::atoi;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <limits>
+
+using std::numeric_limits;
+
+#include <random>
+
+using std::mt19937;
+using std::uniform_int_distribution;
+using std::uniform_real_distribution;
+
+#include <vector>
+
+using std::vector;
+
+#include <memory>
+
+using std::make_shared;
+
+#include <string>
+
+using std::string;
+using std::to_string;
+
+#include "analysis.hpp"
+#include "calibration_batch.hpp"
+#include "test.hpp"
+
+Analysis create_detector_array() {
+    vector<shared_ptr<Module>> modules;
+    vector<shared_ptr<Detector>> detectors;
+    for (unsigned int n_module = 0; n_module < 4; ++n_module) {
+        modules.push_back(make_shared<MDPP16_SCP>(
+            n_module, "amplitude_" + to_string(n_module),
+            "time_" + to_string(n_module),
+            "reference_time_" + to_string(n_module),
+            "timestamp_" + to_string(n_module)));
+        for (size_t n_channel = 0; n_channel < 16; ++n_channel) {
+            const string name = to_string(16 * n_module + n_channel);
+            detectors.push_back(make_shared<EnergySensitiveDetector>(
+                "detector_" + name,
+                vector<EnergySensitiveDetectorChannel>{
+                    {"E1", n_module, n_channel,
+                     Polynomial(vector<double>{0.5 + 0.01 * n_channel, 0.25,
+                                               1e-7}),
+                     Polynomial(vector<double>{-2., 1.}), Gate(0., 20.)}},
+                0));
+        }
+    }
+    return Analysis(modules,
+                    {make_shared<EnergySensitiveDetectorGroup>(
+                        "array", Histogram{65536, -0.125, 16384. - 0.125},
+                        Histogram{65536, -0.5, 65536. - 0.5},
+                        Histogram{2000, -1000. - 0.5, 1000. - 0.5},
+                        Histogram{2000, -1000. - 0.5, 1000. - 0.5})},
+                    detectors, {});
+}
+
+struct RawEvent {
+    vector<double> amplitudes, times;
+    vector<double> reference_times, timestamps;
+    vector<long long> counts;
+};
+
+// About half of the energy-sensitive detector channels have a hit in each
+// event, and the times are spread such that some hits fail the
+// time-vs-reference-time gates.
+vector<RawEvent> create_events(const Analysis &analysis,
+                               const unsigned int n_events) {
+    mt19937 random_engine(0);
+    uniform_int_distribution<int> hit_distribution(0, 1),
+        amplitude_distribution(0, 16000), counts_distribution(0, 100);
+    uniform_real_distribution<double> time_distribution(-10., 30.);
+
+    vector<RawEvent> events(n_events);
+    for (unsigned int n_event = 0; n_event < n_events; ++n_event) {
+        RawEvent &event = events[n_event];
+        for (size_t n_channel_index = 0;
+             n_channel_index < analysis.channel_modules.size();
+             ++n_channel_index) {
+            event.amplitudes.push_back(
+                hit_distribution(random_engine)
+                    ? amplitude_distribution(random_engine)
+                    : numeric_limits<double>::quiet_NaN());
+            event.times.push_back(time_distribution(random_engine));
+        }
+        for (size_t n_module = 0; n_module < analysis.digitizer_modules.size();
+             ++n_module) {
+            event.reference_times.push_back(0.);
+            event.timestamps.push_back(100. * n_event);
+        }
+        for (size_t n_channel_index = 0;
+             n_channel_index < analysis.get_n_counter_detector_channels();
+             ++n_channel_index) {
+            event.counts.push_back(counts_distribution(random_engine));
+        }
+    }
+    return events;
+}
+
+void set_raw_leaves(Analysis &analysis, const RawEvent &event) {
+    size_t n_channel_index = 0;
+    for (size_t n_detector = 0;
+         n_detector < analysis.energy_sensitive_detectors.size();
+         ++n_detector) {
+        for (size_t n_channel = 0;
+             n_channel <
+             analysis.energy_sensitive_detectors[n_detector]->channels.size();
+             ++n_channel) {
+            analysis.set_amplitude(n_detector, n_channel,
+                                   event.amplitudes[n_channel_index]);
+            analysis.set_time(n_detector, n_channel,
+                              event.times[n_channel_index]);
+            ++n_channel_index;
+        }
+    }
+    for (size_t n_module = 0; n_module < analysis.digitizer_modules.size();
+         ++n_module) {
+        analysis.digitizer_modules[n_module]->set_reference_time(
+            event.reference_times[n_module]);
+        analysis.set_timestamp(n_module, event.timestamps[n_module]);
+    }
+    n_channel_index = 0;
+    for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
+         ++n_detector) {
+        for (size_t n_channel = 0;
+             n_channel < analysis.counter_detectors[n_detector]->channels.size();
+             ++n_channel) {
+            analysis.add_counts(n_detector, n_channel,
+                                event.counts[n_channel_index]);
+            ++n_channel_index;
+        }
+    }
+}
+
+void record_calibrated_leaves(const Analysis &analysis,
+                              vector<double> &results) {
+    const CalibratedChannelTable &table = *analysis.calibrated_channels;
+    for (size_t n_channel_index = 0; n_channel_index < table.size();
+         ++n_channel_index) {
+        results.push_back(table.energy[n_channel_index]);
+        results.push_back(table.time[n_channel_index]);
+        results.push_back(table.time_vs_reference_time[n_channel_index]);
+        results.push_back(table.timestamp[n_channel_index]);
+        results.push_back(table.is_valid(n_channel_index));
+    }
+    for (auto detector : analysis.energy_sensitive_detectors) {
+        results.push_back(detector->addback_energy);
+        results.push_back(detector->addback_time);
+    }
+    for (auto detector : analysis.counter_detectors) {
+        for (const auto &channel : detector->channels) {
+            results.push_back(channel.count_rate);
+        }
+    }
+}
+
+// Calibrate all events, either one by one or in batches of batch_size.
+// If results is not a nullptr, the calibrated leaves of each event are
+// appended to it.
+double calibrate(Analysis analysis, const vector<RawEvent> &events,
+                 const size_t batch_size, vector<double> *results = nullptr) {
+    const auto start = steady_clock::now();
+    if (batch_size > 1) {
+        CalibrationBatch batch(analysis, batch_size);
+        for (size_t n_event = 0; n_event < events.size(); ++n_event) {
+            set_raw_leaves(analysis, events[n_event]);
+            analysis.add_to_batch(batch, n_event);
+            if (batch.is_full() || n_event == events.size() - 1) {
+                analysis.calibrate_batch(batch);
+                for (size_t n_batch_event = 0; n_batch_event < batch.n_events;
+                     ++n_batch_event) {
+                    analysis.load_from_batch(batch, n_batch_event);
+                    if (results != nullptr) {
+                        record_calibrated_leaves(analysis, *results);
+                    }
+                    analysis.reset_calibrated_leaves();
+                }
+                batch.clear();
+            }
+        }
+    } else {
+        for (size_t n_event = 0; n_event < events.size(); ++n_event) {
+            set_raw_leaves(analysis, events[n_event]);
+            analysis.calibrate((long long)n_event);
+            if (results != nullptr) {
+                record_calibrated_leaves(analysis, *results);
+            }
+            analysis.reset_calibrated_leaves();
+        }
+    }
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+void benchmark(const string name, const Analysis &analysis,
+               const unsigned int n_events, const size_t batch_size) {
+    const vector<RawEvent> events = create_events(analysis, n_events);
+
+    vector<double> scalar_results, batch_results;
+    calibrate(analysis.clone(), events, 1, &scalar_results);
+    calibrate(analysis.clone(), events, batch_size, &batch_results);
+    assert(scalar_results.size() == batch_results.size());
+    for (size_t i = 0; i < scalar_results.size(); ++i) {
+        assert((isnan(scalar_results[i]) && isnan(batch_results[i])) ||
+               scalar_results[i] == batch_results[i]);
+    }
+
+    const double scalar_time = calibrate(analysis.clone(), events, 1);
+    const double batch_time = calibrate(analysis.clone(), events, batch_size);
+    cout << name << ": event by event " << n_events / scalar_time
+         << " events/s, batches of " << batch_size << " "
+         << n_events / batch_time << " events/s (speedup "
+         << scalar_time / batch_time << ")" << endl;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int n_events = argc > 1 ? atoi(argv[1]) : 100000;
+    const size_t batch_size = argc > 2 ? atoi(argv[2]) : 64;
+
+    benchmark("Test analysis", analysis, n_events, batch_size);
+    benchmark("Detector array", create_detector_array(), n_events, batch_size);
+}
@@ -0,0 +1,302 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Measure the throughput of the EventBuilder on a synthetic listfile of
+// MDPP-16 modules that are read out with a different delay each, so that the
+// data of one trigger are spread over the file.
+// The built events are compared to the triggers from which the listfile was
+// created.
+
+#include <cassert>
+
+#include <algorithm>
+
+using std::shuffle;
+
+#include <chrono>
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+#include <cstdlib>
+
+using std::atoi;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <memory>
+
+using std::make_shared;
+using std::shared_ptr;
+
+#include <random>
+
+using std::bernoulli_distribution;
+using std::mt19937;
+using std::uniform_int_distribution;
+
+#include <string>
+
+using std::to_string;
+
+#include <vector>
+
+using std::vector;
+
+#include "event_builder.hpp"
+#include "mdpp16_scp.hpp"
+
+constexpr uint32_t n_modules = 8;
+// Number of triggers after which all modules are read out.
+constexpr unsigned int readout_cycle = 32;
+// The spread of the timestamps of the modules for a single trigger is at most
+// twice the jitter, which is much smaller than the distance between two
+// triggers. Therefore, the window can separate the triggers unambiguously.
+constexpr uint64_t jitter = 5;
+constexpr uint64_t window = 20;
+
+struct Listfile {
+    vector<uint32_t> words;
+    // Trigger number for each module header in 'words'.
+    vector<unsigned int> trigger_of_header;
+    // Number of modules that recorded data for each trigger.
+    vector<uint32_t> n_modules_of_trigger;
+    size_t n_frames;
+};
+
+// Each module records a trigger with a different probability.
+// The data of module n_module are written to the listfile n_module % 4
+// readout cycles after the trigger, which creates a lag between the modules
+// of up to 3 * readout_cycle triggers.
+Listfile create_listfile(const unsigned int n_triggers) {
+    mt19937 random_engine(0);
+    uniform_int_distribution<uint64_t> trigger_distance_distribution(60, 140),
+        jitter_distribution(0, 2 * jitter);
+    uniform_int_distribution<uint32_t> n_hits_distribution(1, 4),
+        channel_distribution(0, 15), data_distribution(0, 0xFFFF);
+
+    Listfile listfile;
+    listfile.n_modules_of_trigger.assign(n_triggers, 0);
+    listfile.n_frames = 0;
+
+    // Start close to the overflow of the low stamp.
+    uint64_t trigger_timestamp = MDPP16::high_stamp_offset - 1000;
+    vector<uint64_t> trigger_timestamps(n_triggers);
+    vector<vector<bool>> fired(n_triggers, vector<bool>(n_modules));
+    for (unsigned int n_trigger = 0; n_trigger < n_triggers; ++n_trigger) {
+        trigger_timestamp += trigger_distance_distribution(random_engine);
+        trigger_timestamps[n_trigger] = trigger_timestamp;
+        for (uint32_t n_module = 0; n_module < n_modules; ++n_module) {
+            fired[n_trigger][n_module] =
+                bernoulli_distribution(0.3 + 0.1 * (n_module % 8))(
+                    random_engine);
+            listfile.n_modules_of_trigger[n_trigger] +=
+                fired[n_trigger][n_module];
+        }
+    }
+
+    const unsigned int n_cycles =
+        (n_triggers + readout_cycle - 1) / readout_cycle;
+    vector<uint32_t> readout_order(n_modules);
+    for (uint32_t n_module = 0; n_module < n_modules; ++n_module) {
+        readout_order[n_module] = n_module;
+    }
+    for (unsigned int n_cycle = 0; n_cycle < n_cycles + 3; ++n_cycle) {
+        shuffle(readout_order.begin(), readout_order.end(), random_engine);
+        for (auto n_module : readout_order) {
+            const unsigned int delay = n_module % 4;
+            if (n_cycle < delay || n_cycle - delay >= n_cycles) {
+                continue;
+            }
+            const unsigned int first_trigger =
+                (n_cycle - delay) * readout_cycle;
+            for (unsigned int n_trigger = first_trigger;
+                 n_trigger < first_trigger + readout_cycle &&
+                 n_trigger < n_triggers;
+                 ++n_trigger) {
+                if (!fired[n_trigger][n_module]) {
+                    continue;
+                }
+                const uint64_t timestamp = trigger_timestamps[n_trigger] +
+                                           jitter_distribution(random_engine);
+                const uint32_t n_hits = n_hits_distribution(random_engine);
+                listfile.trigger_of_header.resize(listfile.words.size() + 1);
+                listfile.trigger_of_header.back() = n_trigger;
+                listfile.words.push_back(MDPP16::header_found_flag |
+                                         (n_module << 16) |
+                                         (2 * n_hits + 2));
+                for (uint32_t n_hit = 0; n_hit < n_hits; ++n_hit) {
+                    const uint32_t channel =
+                        channel_distribution(random_engine);
+                    listfile.words.push_back(MDPP16::data_found_flag |
+                                             (channel << 16) |
+                                             data_distribution(random_engine));
+                    listfile.words.push_back(MDPP16::data_found_flag |
+                                             ((channel + 16) << 16) |
+                                             data_distribution(random_engine));
+                }
+                listfile.words.push_back(
+                    MDPP16::extended_ts_flag |
+                    (uint32_t)(timestamp / MDPP16::high_stamp_offset));
+                listfile.words.push_back(
+                    MDPP16::eoe_found_flag |
+                    (uint32_t)(timestamp % MDPP16::high_stamp_offset));
+                ++listfile.n_frames;
+            }
+        }
+    }
+    listfile.trigger_of_header.resize(listfile.words.size());
+    return listfile;
+}
+
+// Read the listfile like the 'mvlclst' reader and build events from it.
+// If check is true, compare the events to the triggers. Events may only be
+// split if the buffer capacity is too small for the lag between the modules.
+// Returns the number of built events.
+size_t build_events(const Listfile &listfile,
+                    const vector<shared_ptr<MDPP16>> &modules,
+                    const size_t capacity, const bool check) {
+    EventBuilder event_builder(n_modules, window, capacity);
+    vector<ModuleFrame> event;
+    ModuleFrame frame;
+    size_t n_word = 0, n_events = 0, n_frames = 0;
+    long long previous_trigger = -1;
+    vector<bool> module_in_event(n_modules);
+    // The first modules start sending frames 3 readout cycles before the
+    // last ones.
+    const bool splitting_expected = capacity < 4 * readout_cycle;
+
+    while (true) {
+        while (!event_builder.is_ready() && n_word < listfile.words.size()) {
+            frame.module = modules[0]->get_module_id(listfile.words[n_word]);
+            frame.n_words = modules[frame.module]->get_data_length(
+                listfile.words[n_word]);
+            frame.words = listfile.words.data() + n_word + 1;
+            modules[frame.module]->get_timestamp(frame.words, frame.n_words,
+                                                 frame.timestamp);
+            event_builder.push(frame);
+            n_word += frame.n_words + 1;
+        }
+        if (event_builder.empty()) {
+            break;
+        }
+        event_builder.build_event(event);
+        ++n_events;
+        n_frames += event.size();
+        if (!check) {
+            continue;
+        }
+
+        module_in_event.assign(n_modules, false);
+        const unsigned int trigger =
+            listfile.trigger_of_header[event[0].words - 1 -
+                                       listfile.words.data()];
+        for (size_t n_frame = 0; n_frame < event.size(); ++n_frame) {
+            assert(!module_in_event[event[n_frame].module]);
+            module_in_event[event[n_frame].module] = true;
+            assert(listfile.trigger_of_header[event[n_frame].words - 1 -
+                                              listfile.words.data()] ==
+                   trigger);
+            if (n_frame > 0) {
+                assert(event[n_frame].timestamp >=
+                       event[n_frame - 1].timestamp);
+            }
+        }
+        if (!splitting_expected) {
+            assert(event.size() == listfile.n_modules_of_trigger[trigger]);
+            assert((long long)trigger > previous_trigger);
+        }
+        previous_trigger = trigger;
+    }
+    assert(n_frames == listfile.n_frames);
+    if (check) {
+        assert((event_builder.get_n_late_frames() > 0) == splitting_expected);
+    }
+    return n_events;
+}
+
+// Only read the frames, for comparison.
+size_t read_frames(const Listfile &listfile,
+                   const vector<shared_ptr<MDPP16>> &modules) {
+    ModuleFrame frame;
+    size_t n_frames = 0;
+    uint64_t timestamp_sum = 0;
+    for (size_t n_word = 0; n_word < listfile.words.size();
+         n_word += frame.n_words + 1) {
+        frame.module = modules[0]->get_module_id(listfile.words[n_word]);
+        frame.n_words =
+            modules[frame.module]->get_data_length(listfile.words[n_word]);
+        frame.words = listfile.words.data() + n_word + 1;
+        modules[frame.module]->get_timestamp(frame.words, frame.n_words,
+                                             frame.timestamp);
+        timestamp_sum += frame.timestamp;
+        ++n_frames;
+    }
+    assert(timestamp_sum > 0);
+    return n_frames;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int n_triggers = argc > 1 ? atoi(argv[1]) : 200000;
+    const Listfile listfile = create_listfile(n_triggers);
+    vector<shared_ptr<MDPP16>> modules;
+    for (uint32_t n_module = 0; n_module < n_modules; ++n_module) {
+        modules.push_back(make_shared<MDPP16_SCP>(
+            n_module, "amplitude_" + to_string(n_module),
+            "time_" + to_string(n_module),
+            "reference_time_" + to_string(n_module),
+            "timestamp_" + to_string(n_module)));
+    }
+
+    const size_t n_events = build_events(listfile, modules, 1024, true);
+    size_t n_triggers_with_data = 0;
+    for (auto n : listfile.n_modules_of_trigger) {
+        n_triggers_with_data += n > 0;
+    }
+    assert(n_events == n_triggers_with_data);
+    const size_t n_split_events = build_events(listfile, modules, 16, true);
+    assert(n_split_events > n_events);
+
+    const double megabytes = listfile.words.size() * sizeof(uint32_t) * 1e-6;
+    auto start = steady_clock::now();
+    read_frames(listfile, modules);
+    const double read_time =
+        duration<double>(steady_clock::now() - start).count();
+    cout << "Read " << listfile.n_frames << " module frames ("
+         << megabytes / read_time << " MB/s, "
+         << listfile.n_frames / read_time * 1e-6 << " million frames/s)"
+         << endl;
+
+    for (const size_t capacity : {128, 1024, 16384}) {
+        start = steady_clock::now();
+        const size_t n_built_events =
+            build_events(listfile, modules, capacity, false);
+        const double build_time =
+            duration<double>(steady_clock::now() - start).count();
+        cout << "Built " << n_built_events
+             << " events with a buffer capacity of " << capacity
+             << " frames per module (" << megabytes / build_time
+             << " MB/s, " << listfile.n_frames / build_time * 1e-6
+             << " million frames/s)" << endl;
+    }
+    cout << "With a buffer capacity of 16 frames per module, which is smaller "
+            "than the lag between the modules, "
+         << n_split_events << " events were built." << endl;
+}
@@ -0,0 +1,201 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Compare the fill rate of TH1D::Fill() with the counting histograms of
+// carolina, for a single thread and for several threads that fill either one
+// shared atomic histogram or one histogram per thread ('shards') that are
+// added at the end.
+// The bin contents of all histograms must be identical.
+
+#include <cassert>
+
+#include <algorithm>
+
+using std::min;
+
+#include <atomic>
+
+using std::atomic;
+
+#include <chrono>
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+#include <cstdlib>
+
+using std::atoi;
+
+#include <functional>
+
+using std::function;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <random>
+
+using std::mt19937;
+using std::normal_distribution;
+
+#include <string>
+
+using std::string;
+using std::to_string;
+
+#include <thread>
+
+using std::thread;
+
+#include <vector>
+
+using std::vector;
+
+#include "TH1.h"
+#include "TH1D.h"
+
+#include "counting_histogram.hpp"
+#include "histogram_properties.hpp"
+
+const Histogram histogram_properties(8192, -4096.5, 4095.5);
+
+// Normally distributed values, with a small fraction outside of the range of
+// the histogram.
+vector<double> create_values(const size_t n_values) {
+    mt19937 random_engine(0);
+    normal_distribution<double> distribution(0., 1500.);
+    vector<double> values(n_values);
+    for (auto &value : values) {
+        value = distribution(random_engine);
+    }
+    return values;
+}
+
+double measure(const function<void()> fill) {
+    const auto start = steady_clock::now();
+    fill();
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+template <typename Count>
+void check(const TH1D &reference, const CountingHistogram1D<Count> &histogram) {
+    for (size_t bin = 0; bin < histogram_properties.n_bins + 2; ++bin) {
+        assert(reference.GetBinContent(bin) == histogram.get_bin_content(bin));
+    }
+    assert(reference.GetEntries() == histogram.get_entries());
+}
+
+void print(const string name, const size_t n_values, const double time,
+           const double reference_time) {
+    cout << name << ": " << n_values / time << " fills/s (speedup "
+         << reference_time / time << ")" << endl;
+}
+
+template <typename Count>
+void benchmark_single_thread(const string name, const vector<double> &values,
+                             const TH1D &reference,
+                             const double reference_time) {
+    CountingHistogram1D<Count> histogram("histogram", histogram_properties);
+    const double time = measure([&]() {
+        for (auto value : values) {
+            histogram.fill(value);
+        }
+    });
+    check(reference, histogram);
+    print(name, values.size(), time, reference_time);
+}
+
+// Call fill(n_thread, first, last) for n_threads equal parts of the values in
+// parallel.
+void fill_in_parallel(
+    const vector<double> &values, const unsigned int n_threads,
+    const function<void(const unsigned int, const size_t, const size_t)>
+        fill) {
+    vector<thread> threads;
+    const size_t n_values_per_thread = values.size() / n_threads + 1;
+    for (unsigned int n_thread = 0; n_thread < n_threads; ++n_thread) {
+        const size_t first = n_thread * n_values_per_thread;
+        const size_t last =
+            min(first + n_values_per_thread, values.size());
+        threads.push_back(thread(fill, n_thread, first, last));
+    }
+    for (auto &worker : threads) {
+        worker.join();
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t n_values = argc > 1 ? atoi(argv[1]) : 10000000;
+    const unsigned int n_threads = argc > 2 ? atoi(argv[2]) : 4;
+    const vector<double> values = create_values(n_values);
+
+    TH1::AddDirectory(false);
+    TH1D reference("reference", "reference", histogram_properties.n_bins,
+                   histogram_properties.lower_edge_of_first_bin,
+                   histogram_properties.upper_edge_of_last_bin);
+    const double reference_time = measure([&]() {
+        for (auto value : values) {
+            reference.Fill(value);
+        }
+    });
+    print("TH1D::Fill", n_values, reference_time, reference_time);
+
+    benchmark_single_thread<uint32_t>("CountingHistogram1D<uint32_t>", values,
+                                      reference, reference_time);
+    benchmark_single_thread<uint64_t>("CountingHistogram1D<uint64_t>", values,
+                                      reference, reference_time);
+    benchmark_single_thread<atomic<uint64_t>>(
+        "CountingHistogram1D<atomic<uint64_t>>", values, reference,
+        reference_time);
+
+    CountingHistogram1D<atomic<uint64_t>> shared_histogram(
+        "histogram", histogram_properties);
+    const double shared_time = measure([&]() {
+        fill_in_parallel(values, n_threads,
+                         [&](const unsigned int, const size_t first,
+                             const size_t last) {
+                             for (size_t n = first; n < last; ++n) {
+                                 shared_histogram.fill(values[n]);
+                             }
+                         });
+    });
+    check(reference, shared_histogram);
+    print(to_string(n_threads) + " threads, shared atomic histogram",
+          n_values, shared_time, reference_time);
+
+    vector<CountingHistogram1D<>> shards;
+    for (unsigned int n_thread = 0; n_thread < n_threads; ++n_thread) {
+        shards.emplace_back("histogram", histogram_properties);
+    }
+    const double sharded_time = measure([&]() {
+        fill_in_parallel(values, n_threads,
+                         [&](const unsigned int n_thread, const size_t first,
+                             const size_t last) {
+                             for (size_t n = first; n < last; ++n) {
+                                 shards[n_thread].fill(values[n]);
+                             }
+                         });
+        for (unsigned int n_thread = 1; n_thread < n_threads; ++n_thread) {
+            shards[0].add(shards[n_thread]);
+        }
+    });
+    check(reference, shards[0]);
+    print(to_string(n_threads) + " threads, one histogram per thread",
+          n_values, sharded_time, reference_time);
+}
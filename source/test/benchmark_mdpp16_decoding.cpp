@@ -0,0 +1,177 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Compare the per-word decoding of MDPP-16 listfile data, which calls the
+// virtual classification functions for each word, with the batched
+// MDPP16::process_event() on a synthetic stream of events.
+// The output of both methods must be identical.
+
+#include <cassert>
+
+#include <chrono>
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+#include <cmath>
+
+using std::isnan;
+
+#include <cstdlib>
+
+using std::atoi;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <memory>
+
+using std::make_shared;
+using std::shared_ptr;
+
+#include <random>
+
+using std::mt19937;
+using std::uniform_int_distribution;
+
+#include <string>
+
+using std::string;
+
+#include <vector>
+
+using std::vector;
+
+#include "mdpp16_qdc.hpp"
+#include "mdpp16_scp.hpp"
+
+// Each event consists of a header, the data words of n_hits random channels
+// (amplitude and time), reference time words, an extended timestamp and an
+// end-of-event word.
+// Besides the channel addresses that are used by all firmwares, the stream
+// contains addresses 32 to 63, which the QDC firmware must ignore.
+vector<u_int32_t> create_event_stream(const unsigned int n_events,
+                                      const u_int32_t module_id) {
+    mt19937 random_engine(0);
+    uniform_int_distribution<u_int32_t> n_hits_distribution(1, 16),
+        channel_distribution(0, 15), data_distribution(0, 0xFFFF),
+        reference_time_address_distribution(32, 63);
+
+    vector<u_int32_t> stream;
+    vector<u_int32_t> payload;
+    for (unsigned int n_event = 0; n_event < n_events; ++n_event) {
+        payload.clear();
+        const u_int32_t n_hits = n_hits_distribution(random_engine);
+        for (u_int32_t n_hit = 0; n_hit < n_hits; ++n_hit) {
+            const u_int32_t channel = channel_distribution(random_engine);
+            payload.push_back(0x10000000 | (channel << 16) |
+                              data_distribution(random_engine));
+            payload.push_back(0x10000000 | ((channel + 16) << 16) |
+                              data_distribution(random_engine));
+        }
+        payload.push_back(0x10000000 | (32 << 16) |
+                          data_distribution(random_engine));
+        payload.push_back(
+            0x10000000 |
+            (reference_time_address_distribution(random_engine) << 16) |
+            data_distribution(random_engine));
+        payload.push_back(0x04800000 | data_distribution(random_engine));
+        payload.push_back(0xC0000000 | data_distribution(random_engine));
+
+        stream.push_back(0x40000000 | (module_id << 16) |
+                         (u_int32_t)payload.size());
+        stream.insert(stream.end(), payload.begin(), payload.end());
+    }
+    return stream;
+}
+
+bool same_value(const double a, const double b) {
+    return (isnan(a) && isnan(b)) || a == b;
+}
+
+void check_leaves(const MDPP16 &module_1, const MDPP16 &module_2) {
+    for (size_t n_leaf = 0; n_leaf < 16; ++n_leaf) {
+        assert(same_value(module_1.amplitude.leaves[n_leaf],
+                          module_2.amplitude.leaves[n_leaf]));
+        assert(
+            same_value(module_1.time.leaves[n_leaf], module_2.time.leaves[n_leaf]));
+    }
+    assert(same_value(module_1.reference_time.leaves[0],
+                      module_2.reference_time.leaves[0]));
+    assert(module_1.timestamp.leaves[0] == module_2.timestamp.leaves[0]);
+}
+
+// Decode all events in the stream, either word by word or in batches.
+// If reference is not a nullptr, compare the result to the per-word decoding
+// of the same event by reference after each event.
+// The leaves are only reset between events for the comparison, so that the
+// timing is not dominated by the reset.
+double decode(const vector<u_int32_t> &stream, shared_ptr<MDPP16> module,
+              const bool batched, shared_ptr<MDPP16> reference = nullptr) {
+    const auto start = steady_clock::now();
+    size_t n_events_found = 0;
+    for (size_t n_word = 0; n_word < stream.size();) {
+        const u_int32_t data_length = module->get_data_length(stream[n_word]);
+        const u_int32_t *payload = stream.data() + n_word + 1;
+        const bool end_of_event =
+            batched ? module->process_event(payload, data_length)
+                    : module->Module::process_event(payload, data_length);
+        n_events_found += end_of_event;
+        if (reference != nullptr) {
+            assert(reference->Module::process_event(payload, data_length) ==
+                   end_of_event);
+            check_leaves(*module, *reference);
+            reference->reset_raw_leaves({true, true, true, true});
+            module->reset_raw_leaves({true, true, true, true});
+        }
+        n_word += data_length + 1;
+    }
+    assert(n_events_found > 0);
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+void benchmark(const string firmware, const vector<u_int32_t> &stream,
+               shared_ptr<MDPP16> module, shared_ptr<MDPP16> reference) {
+    module->reset_raw_leaves({true, true, true, true});
+    reference->reset_raw_leaves({true, true, true, true});
+    decode(stream, module, true, reference);
+
+    const double per_word_time = decode(stream, module, false);
+    const double batched_time = decode(stream, module, true);
+    const double megabytes = stream.size() * sizeof(u_int32_t) * 1e-6;
+    cout << firmware << ": per-word " << megabytes / per_word_time
+         << " MB/s, batched " << megabytes / batched_time << " MB/s (speedup "
+         << per_word_time / batched_time << ")" << endl;
+}
+
+int main(int argc, char **argv) {
+    const unsigned int n_events = argc > 1 ? atoi(argv[1]) : 200000;
+    const vector<u_int32_t> stream = create_event_stream(n_events, 0x0);
+
+    benchmark("MDPP-16 SCP", stream,
+              make_shared<MDPP16_SCP>(0x0, "amplitude", "time",
+                                      "reference_time", "timestamp"),
+              make_shared<MDPP16_SCP>(0x0, "amplitude", "time",
+                                      "reference_time", "timestamp"));
+    benchmark("MDPP-16 QDC", stream,
+              make_shared<MDPP16_QDC>(0x0, "amplitude", "time",
+                                      "reference_time", "timestamp"),
+              make_shared<MDPP16_QDC>(0x0, "amplitude", "time",
+                                      "reference_time", "timestamp"));
+}
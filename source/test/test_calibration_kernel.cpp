@@ -0,0 +1,95 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+
+#include <limits>
+
+using std::numeric_limits;
+
+#include <vector>
+
+using std::vector;
+
+#include "calibration_function.hpp"
+#include "calibration_kernel.hpp"
+#include "energy_sensitive_detector_channel.hpp"
+#include "gate.hpp"
+
+int main() {
+    const double nan = numeric_limits<double>::quiet_NaN();
+    const vector<double> arguments = {-1e3, -1.5, -0., 0., 0.25, 17., 4e4, nan};
+
+    // Default calibrations are recognized.
+    const EnergySensitiveDetectorChannel default_channel("E1", 0, 0);
+    const CalibrationKernel default_kernel(default_channel);
+    assert(default_kernel.energy.n_parameters == 2);
+    assert(default_kernel.time.n_parameters == 2);
+    assert(default_kernel.gate.type == GateKernel::Type::open);
+    assert(default_kernel.time_vs_reference_time_gate(default_channel, nan));
+
+    // Polynomials and gates are recognized and give the same results as the
+    // std::function objects.
+    const EnergySensitiveDetectorChannel polynomial_channel(
+        "E1", 0, 0,
+        calibration_function<const double, const long long>("1.5 0.25 1e-5"),
+        calibration_function<const double, const double>(
+            vector<double>{-3., 0.5}),
+        Gate::gate(-10., 20.));
+    const CalibrationKernel polynomial_kernel(polynomial_channel);
+    assert(polynomial_kernel.energy.n_parameters == 3);
+    assert(polynomial_kernel.time.n_parameters == 2);
+    assert(polynomial_kernel.gate.type == GateKernel::Type::interval);
+
+    for (auto x : arguments) {
+        const double energy =
+            polynomial_kernel.calibrate_energy(polynomial_channel, x, 0);
+        const double time =
+            polynomial_kernel.calibrate_time(polynomial_channel, x, energy);
+        if (x != x) {
+            assert(energy != energy);
+            assert(time != time);
+        } else {
+            assert(energy == polynomial_channel.energy_calibration(x, 0));
+            assert(time == polynomial_channel.time_calibration(x, energy));
+        }
+        assert(polynomial_kernel.time_vs_reference_time_gate(
+                   polynomial_channel, x) ==
+               polynomial_channel.time_vs_reference_time_gate(x));
+    }
+
+    // Custom functions and polynomials with too many parameters fall back to
+    // the std::function objects.
+    const EnergySensitiveDetectorChannel custom_channel(
+        "E1", 0, 0,
+        [](const double amplitude, const long long n_entry) {
+            return amplitude + n_entry;
+        },
+        calibration_function<const double, const double>(
+            vector<double>{1., 2., 3., 4., 5.}),
+        Gate::gate([](const double time_vs_reference_time) {
+            return time_vs_reference_time > 0.;
+        }));
+    const CalibrationKernel custom_kernel(custom_channel);
+    assert(custom_kernel.energy.n_parameters == 0);
+    assert(custom_kernel.time.n_parameters == 0);
+    assert(custom_kernel.gate.type == GateKernel::Type::custom);
+    assert(custom_kernel.calibrate_energy(custom_channel, 1., 2) == 3.);
+    assert(custom_kernel.calibrate_time(custom_channel, 1., 0.) == 15.);
+    assert(custom_kernel.time_vs_reference_time_gate(custom_channel, 1.));
+    assert(!custom_kernel.time_vs_reference_time_gate(custom_channel, -1.));
+}
@@ -0,0 +1,106 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Check that the counting histograms sort values into the same bins as
+// TH1::Fill(), in particular values that lie exactly on a bin edge, and the
+// neighboring floating-point numbers.
+
+#include <cassert>
+
+#include <cmath>
+
+using std::nextafter;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <limits>
+
+using std::numeric_limits;
+
+#include <vector>
+
+using std::vector;
+
+#include "TH1.h"
+#include "TH1D.h"
+
+#include "counting_histogram.hpp"
+#include "histogram_properties.hpp"
+
+// Bin edges as computed by TAxis::GetBinLowEdge(), the exact multiples of the
+// bin width, and their neighbors.
+vector<double> create_values(const Histogram &properties) {
+    const double lower = properties.lower_edge_of_first_bin,
+                 upper = properties.upper_edge_of_last_bin;
+    const double bin_width = (upper - lower) / properties.n_bins;
+    vector<double> edges;
+    for (unsigned int bin = 1; bin <= properties.n_bins + 1; ++bin) {
+        edges.push_back(lower + (bin - 1) * bin_width);
+        edges.push_back(lower +
+                        (upper - lower) * (bin - 1) / properties.n_bins);
+    }
+    vector<double> values;
+    for (auto edge : edges) {
+        values.push_back(nextafter(edge, -numeric_limits<double>::infinity()));
+        values.push_back(edge);
+        values.push_back(nextafter(edge, numeric_limits<double>::infinity()));
+    }
+    values.push_back(numeric_limits<double>::quiet_NaN());
+    return values;
+}
+
+int main() {
+    // Binnings whose bin widths and inverse bin widths are not exactly
+    // representable.
+    const vector<Histogram> binnings{
+        Histogram(8192, -4096.5, 4095.5), Histogram(65536, 0., 65536.),
+        Histogram(1000, 0., 0.1), Histogram(3, 0., 1.),
+        Histogram(7, -1.3, 2.9), Histogram(49, 0.1, 0.7)};
+
+    TH1::AddDirectory(false);
+    size_t n_values = 0;
+    for (const auto &binning : binnings) {
+        const vector<double> values = create_values(binning);
+        TH1D reference("reference", "reference", binning.n_bins,
+                       binning.lower_edge_of_first_bin,
+                       binning.upper_edge_of_last_bin);
+        CountingHistogram1D<> histogram("histogram", binning);
+        for (auto value : values) {
+            assert((size_t)reference.FindBin(value) ==
+                   histogram.x_axis.find_bin(value));
+            reference.Fill(value);
+            histogram.fill(value);
+        }
+
+        TH1D *converted = histogram.to_root_histogram<TH1D>();
+        for (size_t bin = 0; bin < binning.n_bins + 2; ++bin) {
+            assert(reference.GetBinContent(bin) ==
+                   histogram.get_bin_content(bin));
+            assert(converted->GetBinContent(bin) ==
+                   reference.GetBinContent(bin));
+        }
+        assert(converted->GetEntries() == reference.GetEntries());
+        delete converted;
+        n_values += values.size();
+    }
+
+    cout << "Sorted " << n_values << " values on and next to bin edges into "
+         << "the same bins as TH1D." << endl;
+}
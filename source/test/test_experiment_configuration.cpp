@@ -0,0 +1,219 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Compare the analysis that is read from 'test.json' with the one that is
+// compiled from 'test.hpp', once after parsing the JSON file and once after
+// reading the binary cache.
+// Check that the cache is invalidated by a modification of the JSON file
+// within the same second.
+//
+// Usage: test_experiment_configuration JSON_FILE CACHE_FILE
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <cassert>
+
+#include <chrono>
+
+using std::chrono::duration;
+using std::chrono::steady_clock;
+
+#include <cstdio>
+
+using std::remove;
+
+#include <cstdlib>
+
+using std::abort;
+
+#include <fstream>
+
+using std::ifstream;
+using std::ofstream;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <limits>
+
+using std::numeric_limits;
+
+#include <string>
+
+using std::string;
+
+#include <vector>
+
+using std::vector;
+
+#include "calibration_kernel.hpp"
+#include "experiment_configuration.hpp"
+#include "test.hpp"
+
+void compare_histograms(const Histogram &histogram,
+                        const Histogram &expected_histogram) {
+    assert(histogram.n_bins == expected_histogram.n_bins);
+    assert(histogram.lower_edge_of_first_bin ==
+           expected_histogram.lower_edge_of_first_bin);
+    assert(histogram.upper_edge_of_last_bin ==
+           expected_histogram.upper_edge_of_last_bin);
+}
+
+// The custom calibrations and gates of the test analysis are compared by
+// evaluating them.
+void compare(const Analysis &configured_analysis) {
+    const vector<double> arguments = {-1e3, -2.5, -1., 0., 0.25,
+                                      2.5,  17.,  20., 4e4};
+
+    assert(configured_analysis.modules.size() == analysis.modules.size());
+    for (size_t n_module = 0; n_module < analysis.modules.size();
+         ++n_module) {
+        assert(configured_analysis.modules[n_module]->address ==
+               analysis.modules[n_module]->address);
+    }
+
+    assert(configured_analysis.detector_groups.size() ==
+           analysis.detector_groups.size());
+    for (size_t n_group = 0; n_group < analysis.detector_groups.size();
+         ++n_group) {
+        const auto &group = *configured_analysis.detector_groups[n_group];
+        const auto &expected_group = *analysis.detector_groups[n_group];
+        assert(group.name == expected_group.name);
+        compare_histograms(group.histogram_properties,
+                           expected_group.histogram_properties);
+        compare_histograms(group.raw_histogram_properties,
+                           expected_group.raw_histogram_properties);
+    }
+
+    assert(configured_analysis.detectors.size() == analysis.detectors.size());
+    assert(configured_analysis.counter_detectors.size() ==
+           analysis.counter_detectors.size());
+    assert(configured_analysis.energy_sensitive_detectors.size() ==
+           analysis.energy_sensitive_detectors.size());
+    for (size_t n_detector = 0;
+         n_detector < analysis.energy_sensitive_detectors.size();
+         ++n_detector) {
+        const auto &detector =
+            *configured_analysis.energy_sensitive_detectors[n_detector];
+        const auto &expected_detector =
+            *analysis.energy_sensitive_detectors[n_detector];
+        assert(detector.name == expected_detector.name);
+        assert(detector.group == expected_detector.group);
+        assert(detector.channels.size() == expected_detector.channels.size());
+        for (size_t n_channel = 0; n_channel < detector.channels.size();
+             ++n_channel) {
+            const auto &channel = detector.channels[n_channel];
+            const auto &expected_channel =
+                expected_detector.channels[n_channel];
+            assert(channel.name == expected_channel.name);
+            assert(channel.module == expected_channel.module);
+            assert(channel.channel == expected_channel.channel);
+            // All calibrations from a file can be evaluated without calling
+            // the std::function objects.
+            const CalibrationKernel kernel(channel);
+            assert(kernel.energy.n_parameters > 0);
+            assert(kernel.time.n_parameters > 0);
+            assert(kernel.gate.type == GateKernel::Type::interval);
+            for (auto x : arguments) {
+                assert(channel.energy_calibration(x, 0) ==
+                       expected_channel.energy_calibration(x, 0));
+                assert(channel.time_calibration(x, 0.) ==
+                       expected_channel.time_calibration(x, 0.));
+                assert(channel.time_vs_reference_time_gate(x) ==
+                       expected_channel.time_vs_reference_time_gate(x));
+            }
+        }
+        assert(detector.addback_coincidence_gates.size() ==
+               expected_detector.addback_coincidence_gates.size());
+        for (size_t i = 0; i < detector.addback_coincidence_gates.size(); ++i) {
+            assert(detector.addback_coincidence_gates[i].size() ==
+                   expected_detector.addback_coincidence_gates[i].size());
+            for (size_t j = 0; j < detector.addback_coincidence_gates[i].size();
+                 ++j) {
+                for (auto x : arguments) {
+                    assert(detector.addback_coincidence_gates[i][j](x) ==
+                           expected_detector.addback_coincidence_gates[i][j](
+                               x));
+                }
+            }
+        }
+    }
+    for (size_t n_detector = 0; n_detector < analysis.counter_detectors.size();
+         ++n_detector) {
+        const auto &detector =
+            *configured_analysis.counter_detectors[n_detector];
+        const auto &expected_detector = *analysis.counter_detectors[n_detector];
+        assert(detector.name == expected_detector.name);
+        assert(detector.channels.size() == expected_detector.channels.size());
+    }
+
+    assert(configured_analysis.coincidence_matrices.size() ==
+           analysis.coincidence_matrices.size());
+    for (size_t n_matrix = 0; n_matrix < analysis.coincidence_matrices.size();
+         ++n_matrix) {
+        const auto &matrix = configured_analysis.coincidence_matrices[n_matrix];
+        const auto &expected_matrix = analysis.coincidence_matrices[n_matrix];
+        assert(matrix.name == expected_matrix.name);
+        assert(matrix.detectors_x == expected_matrix.detectors_x);
+        assert(matrix.detectors_y == expected_matrix.detectors_y);
+        compare_histograms(matrix.x_axis, expected_matrix.x_axis);
+        compare_histograms(matrix.y_axis, expected_matrix.y_axis);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cout << "No configuration and cache file given. Aborting ..." << endl;
+        abort();
+    }
+    const string file_name = argv[1], cache_file_name = argv[2];
+    remove(cache_file_name.c_str());
+
+    auto start = steady_clock::now();
+    const Analysis parsed_analysis = load_analysis(file_name, cache_file_name);
+    const double parse_time =
+        duration<double>(steady_clock::now() - start).count();
+    assert(ifstream(cache_file_name).good());
+    compare(parsed_analysis);
+
+    ExperimentConfiguration configuration;
+    assert(configuration.read_cache(cache_file_name, file_name));
+
+    start = steady_clock::now();
+    const Analysis cached_analysis = load_analysis(file_name, cache_file_name);
+    const double cache_time =
+        duration<double>(steady_clock::now() - start).count();
+    compare(cached_analysis);
+
+    cout << "Read configuration from JSON file in " << parse_time * 1e3
+         << " ms, from cache in " << cache_time * 1e3 << " ms" << endl;
+
+    const string copy_file_name = cache_file_name + ".json";
+    ofstream(copy_file_name) << ifstream(file_name).rdbuf();
+    configuration.write_cache(cache_file_name, copy_file_name);
+    assert(configuration.read_cache(cache_file_name, copy_file_name));
+    struct stat file_status;
+    assert(stat(copy_file_name.c_str(), &file_status) == 0);
+    struct timespec times[2] = {file_status.st_atim, file_status.st_mtim};
+    times[1].tv_nsec ^= 1;
+    assert(utimensat(AT_FDCWD, copy_file_name.c_str(), times, 0) == 0);
+    assert(!configuration.read_cache(cache_file_name, copy_file_name));
+    remove(copy_file_name.c_str());
+}
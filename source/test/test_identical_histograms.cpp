@@ -0,0 +1,117 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Compare all histograms in two ROOT files bin by bin, including the
+// underflow and overflow bins, the number of entries and the statistics.
+// This is used to check that different ways of processing the same input, e.g.
+// serially and on several threads, give identical results.
+//
+// Usage: test_identical_histograms FILE_1 FILE_2
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <string>
+
+using std::string;
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+
+// Maximum size of the array of statistics (for a TH3).
+constexpr int n_statistics = 13;
+
+bool compare_histograms(const TH1 *histogram_1, const TH1 *histogram_2) {
+    const string name = histogram_1->GetName();
+    if (histogram_1->GetNcells() != histogram_2->GetNcells()) {
+        cout << "Error: histograms '" << name
+             << "' have different numbers of bins." << endl;
+        return false;
+    }
+    for (int bin = 0; bin < histogram_1->GetNcells(); ++bin) {
+        if (histogram_1->GetBinContent(bin) !=
+            histogram_2->GetBinContent(bin)) {
+            cout << "Error: bin " << bin << " of histograms '" << name
+                 << "' differs (" << histogram_1->GetBinContent(bin)
+                 << " vs. " << histogram_2->GetBinContent(bin) << ")."
+                 << endl;
+            return false;
+        }
+    }
+    if (histogram_1->GetEntries() != histogram_2->GetEntries()) {
+        cout << "Error: histograms '" << name
+             << "' have different numbers of entries." << endl;
+        return false;
+    }
+    double statistics_1[n_statistics] = {0.}, statistics_2[n_statistics] = {0.};
+    histogram_1->GetStats(statistics_1);
+    histogram_2->GetStats(statistics_2);
+    for (int n = 0; n < n_statistics; ++n) {
+        if (statistics_1[n] != statistics_2[n]) {
+            cout << "Error: statistics of histograms '" << name
+                 << "' differ." << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        cout << "Usage: test_identical_histograms FILE_1 FILE_2" << endl;
+        return 1;
+    }
+    TH1::AddDirectory(false);
+    TFile file_1(argv[1], "READ"), file_2(argv[2], "READ");
+    if (file_1.GetListOfKeys()->GetEntries() !=
+        file_2.GetListOfKeys()->GetEntries()) {
+        cout << "Error: the files contain different numbers of objects."
+             << endl;
+        return 1;
+    }
+
+    size_t n_histograms = 0;
+    for (TObject *key_as_object : *file_1.GetListOfKeys()) {
+        auto key = dynamic_cast<TKey *>(key_as_object);
+        TObject *object = key->ReadObj();
+        if (!object->IsA()->InheritsFrom(TH1::Class())) {
+            delete object;
+            continue;
+        }
+        TH1 *histogram_1 = (TH1 *)object;
+        TH1 *histogram_2 = (TH1 *)file_2.Get(key->GetName());
+        if (histogram_2 == nullptr) {
+            cout << "Error: histogram '" << key->GetName()
+                 << "' is missing in '" << argv[2] << "'." << endl;
+            return 1;
+        }
+        if (!compare_histograms(histogram_1, histogram_2)) {
+            return 1;
+        }
+        delete histogram_1;
+        delete histogram_2;
+        ++n_histograms;
+    }
+    file_1.Close();
+    file_2.Close();
+
+    cout << "The " << n_histograms << " histograms in '" << argv[1]
+         << "' and '" << argv[2] << "' are identical." << endl;
+}
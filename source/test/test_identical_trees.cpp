@@ -0,0 +1,116 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Compare two trees entry by entry, e.g. the output of 'calibrate_tree' with
+// different numbers of jobs. The trees may be split into several files, which
+// are given as log files. All branches must contain a single double value,
+// like the branches of the calibrated trees. The values are compared bit by
+// bit, so that two NaNs are equal.
+//
+// Usage: test_identical_trees LOG_FILE_1 LOG_FILE_2
+
+#include <cstring>
+
+using std::memcmp;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <string>
+
+using std::string;
+
+#include <vector>
+
+using std::vector;
+
+#include "TBranch.h"
+#include "TChain.h"
+
+#include "tfile_utilities.hpp"
+
+TChain *set_up_chain(const string log_file_name) {
+    const vector<string> file_names = read_log_file(log_file_name);
+    TChain *chain = new TChain(find_tree_in_file(file_names[0]).c_str());
+    for (auto file_name : file_names) {
+        chain->Add(file_name.c_str());
+    }
+    return chain;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        cout << "Usage: test_identical_trees LOG_FILE_1 LOG_FILE_2" << endl;
+        return 1;
+    }
+    TChain *chain_1 = set_up_chain(argv[1]);
+    TChain *chain_2 = set_up_chain(argv[2]);
+    const long long n_entries = chain_1->GetEntries();
+    if (chain_2->GetEntries() != n_entries) {
+        cout << "Error: the trees have different numbers of entries ("
+             << n_entries << " vs. " << chain_2->GetEntries() << ")." << endl;
+        return 1;
+    }
+
+    vector<string> branch_names;
+    for (TObject *branch : *chain_1->GetListOfBranches()) {
+        branch_names.push_back(branch->GetName());
+    }
+    if ((size_t)chain_2->GetListOfBranches()->GetEntries() !=
+        branch_names.size()) {
+        cout << "Error: the trees have different numbers of branches."
+             << endl;
+        return 1;
+    }
+    vector<double> values_1(branch_names.size()),
+        values_2(branch_names.size());
+    for (size_t n_branch = 0; n_branch < branch_names.size(); ++n_branch) {
+        if (chain_2->GetBranch(branch_names[n_branch].c_str()) == nullptr) {
+            cout << "Error: branch '" << branch_names[n_branch]
+                 << "' is missing in '" << argv[2] << "'." << endl;
+            return 1;
+        }
+        chain_1->SetBranchAddress(branch_names[n_branch].c_str(),
+                                  &values_1[n_branch]);
+        chain_2->SetBranchAddress(branch_names[n_branch].c_str(),
+                                  &values_2[n_branch]);
+    }
+
+    for (long long n_entry = 0; n_entry < n_entries; ++n_entry) {
+        chain_1->GetEntry(n_entry);
+        chain_2->GetEntry(n_entry);
+        for (size_t n_branch = 0; n_branch < branch_names.size();
+             ++n_branch) {
+            if (memcmp(&values_1[n_branch], &values_2[n_branch],
+                       sizeof(double))) {
+                cout << "Error: branch '" << branch_names[n_branch]
+                     << "' differs in entry " << n_entry << " ("
+                     << values_1[n_branch] << " vs. " << values_2[n_branch]
+                     << ")." << endl;
+                return 1;
+            }
+        }
+    }
+    delete chain_1;
+    delete chain_2;
+
+    cout << "The trees in '" << argv[1] << "' and '" << argv[2]
+         << "' are identical (" << n_entries << " entries, "
+         << branch_names.size() << " branches)." << endl;
+}
@@ -0,0 +1,175 @@
+/*
+     This file is part of carolina.
+
+    carolina is free software: you can redistribute it and/or modify it under
+   the terms of the GNU General Public License as published by the Free Software
+   Foundation, either version 3 of the License, or (at your option) any later
+   version.
+
+    carolina is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or
+    FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+    more details.
+
+    You should have received a copy of the GNU General Public License along with
+    carolina. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Read a synthetic listfile in blocks of entries that start at arbitrary
+// entries, both one after another and in parallel, and compare the events with
+// a sequential read of the whole file.
+// The data of each module contain a word that looks like a module header, so
+// a reader that starts inside the data of a module and simply scans for the
+// next header would find events that do not exist.
+//
+// Usage: test_listfile_index LISTFILE
+
+#include <cassert>
+
+#include <cstdio>
+
+using std::remove;
+
+#include <fstream>
+
+using std::ios;
+using std::ofstream;
+
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+#include <memory>
+
+using std::dynamic_pointer_cast;
+
+#include <string>
+
+using std::string;
+
+#include <thread>
+
+using std::thread;
+
+#include <utility>
+
+using std::pair;
+
+#include <vector>
+
+using std::vector;
+
+#include "mvlclst.hpp"
+#include "test.hpp"
+
+constexpr unsigned int n_events = 200000;
+constexpr size_t n_blocks = 7;
+
+void write_listfile(const string &file_name, const unsigned int n_events) {
+    vector<uint32_t> words;
+    for (unsigned int n_event = 0; n_event < n_events; ++n_event) {
+        const uint32_t channel = n_event % 16;
+        words.push_back(MDPP16::header_found_flag | 4);
+        words.push_back(MDPP16::data_found_flag | (channel << 16) |
+                        (n_event % 0xFFFF));
+        words.push_back(MDPP16::header_found_flag | 2);
+        words.push_back(MDPP16::extended_ts_flag);
+        words.push_back(MDPP16::eoe_found_flag | n_event);
+    }
+    ofstream file(file_name, ios::binary);
+    file.write(reinterpret_cast<const char *>(words.data()),
+               words.size() * sizeof(uint32_t));
+}
+
+// Returns the entry and the timestamp of each event.
+vector<pair<long long, uint64_t>> read_events(const string &file_name,
+                                              const long long first,
+                                              const long long last) {
+    Analysis block_analysis = analysis.clone();
+    auto module = dynamic_pointer_cast<MDPP16>(block_analysis.modules[0]);
+    Reader reader({file_name}, first, last);
+    reader.initialize(block_analysis, "", {false}, {true, true, true, true});
+    vector<pair<long long, uint64_t>> events;
+    unsigned int status;
+    while (reader.read(status, block_analysis)) {
+        if (status == 1) {
+            events.push_back({reader.entry, module->timestamp.leaves[0]});
+            block_analysis.reset_raw_energy_sensitive_detector_leaves(
+                {true, true, true, true});
+        }
+    }
+    reader.finalize();
+    return events;
+}
+
+int main(int argc, char **argv) {
+    assert(argc == 2);
+    const string file_name = argv[1];
+    const string index_file_name = file_name + ".idx";
+    write_listfile(file_name, n_events);
+    remove(index_file_name.c_str());
+
+    const vector<pair<long long, uint64_t>> expected_events =
+        read_events(file_name, 0, -1);
+    assert(expected_events.size() == n_events);
+    for (unsigned int n_event = 0; n_event < n_events; ++n_event) {
+        assert(expected_events[n_event].first == n_event);
+        assert(expected_events[n_event].second == n_event);
+    }
+
+    // Block boundaries that do not coincide with indexed entries.
+    vector<pair<long long, long long>> blocks;
+    for (size_t n_block = 0; n_block < n_blocks; ++n_block) {
+        blocks.push_back({n_block * n_events / n_blocks,
+                          (n_block + 1) * n_events / n_blocks - 1});
+    }
+
+    vector<vector<pair<long long, uint64_t>>> block_events(n_blocks);
+    for (size_t n_block = 0; n_block < n_blocks; ++n_block) {
+        block_events[n_block] = read_events(file_name, blocks[n_block].first,
+                                            blocks[n_block].second);
+    }
+    ListfileIndex index;
+    assert(index.read(index_file_name, file_name));
+    assert(index.n_frames == n_events);
+    assert(index.frame_headers.size() > 1);
+    const auto last_events = read_events(file_name, n_events - 1, -1);
+    assert(last_events.size() == 1 &&
+           last_events[0] == expected_events.back());
+    assert(read_events(file_name, n_events, -1).empty());
+
+    // The threads read the index that was created above.
+    vector<vector<pair<long long, uint64_t>>> parallel_block_events(n_blocks);
+    vector<thread> threads;
+    for (size_t n_block = 0; n_block < n_blocks; ++n_block) {
+        threads.emplace_back([&, n_block]() {
+            parallel_block_events[n_block] = read_events(
+                file_name, blocks[n_block].first, blocks[n_block].second);
+        });
+    }
+    for (auto &block_thread : threads) {
+        block_thread.join();
+    }
+
+    vector<pair<long long, uint64_t>> events, parallel_events;
+    for (size_t n_block = 0; n_block < n_blocks; ++n_block) {
+        events.insert(events.end(), block_events[n_block].begin(),
+                      block_events[n_block].end());
+        parallel_events.insert(parallel_events.end(),
+                               parallel_block_events[n_block].begin(),
+                               parallel_block_events[n_block].end());
+    }
+    assert(events == expected_events);
+    assert(parallel_events == expected_events);
+
+    // An index for a different version of the listfile must not be used.
+    write_listfile(file_name, n_events + 1);
+    assert(!index.read(index_file_name, file_name));
+    assert(read_events(file_name, blocks.back().first, -1).size() ==
+           block_events.back().size() + 1);
+    assert(index.read(index_file_name, file_name));
+
+    cout << "Read " << n_events << " events in " << n_blocks
+         << " blocks with the index '" << index_file_name << "'." << endl;
+}